@@ -0,0 +1,38 @@
+#pragma once
+
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+// Runs a batch of independent tasks on a fixed number of threads
+// Each worker owns a queue it pops from the back, and steals from the front of the others once it runs dry
+class WorkStealingPool
+{
+public:
+	using Task = std::function<void()>;
+
+	explicit WorkStealingPool(unsigned int threadCount);
+
+	// Deal the tasks round robin to the workers and return once all of them finished
+	// The calling thread acts as the first worker
+	void Run(std::vector<Task> tasks);
+
+	unsigned int GetThreadCount() const { return static_cast<unsigned int>(queues.size()); }
+
+private:
+	struct Queue
+	{
+		std::mutex mutex;
+		std::deque<Task> tasks;
+	};
+
+	void Work(unsigned int worker);
+	bool Pop(unsigned int worker, Task& task);
+	bool Steal(unsigned int worker, Task& task);
+
+private:
+	// Tasks never spawn tasks, so a worker finding every queue empty is done
+	std::vector<std::unique_ptr<Queue>> queues;
+};
\ No newline at end of file
@@ -0,0 +1,73 @@
+#include "WorkStealingPool.h"
+
+#include <thread>
+#include <utility>
+
+WorkStealingPool::WorkStealingPool(unsigned int threadCount)
+{
+	for (unsigned int i = 0; i < (threadCount > 0 ? threadCount : 1); ++i)
+	{
+		queues.push_back(std::make_unique<Queue>());
+	}
+}
+
+void WorkStealingPool::Run(std::vector<Task> tasks)
+{
+	for (size_t i = 0; i < tasks.size(); ++i)
+	{
+		queues[i % queues.size()]->tasks.push_back(std::move(tasks[i]));
+	}
+
+	std::vector<std::thread> threads;
+	for (unsigned int worker = 1; worker < queues.size(); ++worker)
+	{
+		threads.emplace_back(&WorkStealingPool::Work, this, worker);
+	}
+	Work(0);
+
+	for (std::thread& thread : threads)
+	{
+		thread.join();
+	}
+}
+
+void WorkStealingPool::Work(unsigned int worker)
+{
+	Task task;
+	while (Pop(worker, task) || Steal(worker, task))
+	{
+		task();
+	}
+}
+
+bool WorkStealingPool::Pop(unsigned int worker, Task& task)
+{
+	Queue& queue = *queues[worker];
+	std::lock_guard<std::mutex> lock(queue.mutex);
+	if (queue.tasks.empty())
+	{
+		return false;
+	}
+
+	task = std::move(queue.tasks.back());
+	queue.tasks.pop_back();
+	return true;
+}
+
+bool WorkStealingPool::Steal(unsigned int worker, Task& task)
+{
+	// Visit the other workers starting with the next one, so thieves spread over different victims
+	for (size_t i = 1; i < queues.size(); ++i)
+	{
+		Queue& victim = *queues[(worker + i) % queues.size()];
+		std::lock_guard<std::mutex> lock(victim.mutex);
+		if (!victim.tasks.empty())
+		{
+			task = std::move(victim.tasks.front());
+			victim.tasks.pop_front();
+			return true;
+		}
+	}
+
+	return false;
+}
\ No newline at end of file
@@ -0,0 +1,311 @@
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Chip8.h"
+#include "InputScript.h"
+#include "WorkStealingPool.h"
+
+// One ROM of the corpus, with the input script replayed while it runs
+struct RomJob
+{
+	std::string romPath;
+	std::string inputPath;
+};
+
+struct RomResult
+{
+	bool loaded = false;
+	uint64_t instructions = 0;
+	double seconds = 0.0;
+	uint64_t hash = 0;
+	Chip8::Fault fault = Chip8::Fault::None;
+	uint16_t faultAddress = 0;
+};
+
+struct BatchSettings
+{
+	uint64_t frames = 600;
+	unsigned int cyclesPerFrame = Chip8::DEFAULT_TICK_CYCLES;
+	unsigned int seed = 0;
+	QuirkProfile profile = QuirkProfile::SuperChip;
+	bool fusion = true;
+	bool jit = false;
+};
+
+// Every .ch8 file of a folder, or the lines of a manifest: "rom [inputScript]", # starts a comment
+// Relative manifest paths are resolved against the manifest folder
+static bool LoadCorpus(const std::string& path, std::vector<RomJob>& jobs)
+{
+	if (std::filesystem::is_directory(path))
+	{
+		for (const auto& entry : std::filesystem::directory_iterator(path))
+		{
+			if (entry.is_regular_file() && entry.path().extension() == ".ch8")
+			{
+				jobs.push_back({ entry.path().string(), "" });
+			}
+		}
+		std::sort(jobs.begin(), jobs.end(), [](const RomJob& a, const RomJob& b) { return a.romPath < b.romPath; });
+		return true;
+	}
+
+	std::ifstream file(path);
+	if (!file)
+	{
+		std::cerr << "Failed to open ROM folder or manifest: " << path << std::endl;
+		return false;
+	}
+
+	std::filesystem::path base = std::filesystem::path(path).parent_path();
+	std::string line;
+	while (std::getline(file, line))
+	{
+		std::istringstream fields(line.substr(0, line.find('#')));
+		std::string rom;
+		std::string input;
+		if (!(fields >> rom))
+		{
+			continue;
+		}
+		fields >> input;
+
+		jobs.push_back({ (base / rom).string(), input.empty() ? "" : (base / input).string() });
+	}
+	return true;
+}
+
+static RomResult RunRom(const RomJob& job, const BatchSettings& settings)
+{
+	RomResult result;
+
+	InputScript input;
+	if (!job.inputPath.empty() && !input.Load(job.inputPath))
+	{
+		return result;
+	}
+
+	std::unique_ptr<Chip8> chip8 = std::make_unique<Chip8>();
+	chip8->SetRandomSeed(settings.seed);
+	chip8->SetQuirkProfile(settings.profile);
+	chip8->SetFusionEnabled(settings.fusion);
+	chip8->SetTickCycles(settings.cyclesPerFrame);
+	chip8->SetJITEnabled(settings.jit);
+	if (!chip8->LoadROM(job.romPath))
+	{
+		return result;
+	}
+	result.loaded = true;
+
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	for (uint64_t frame = 0; frame < settings.frames; ++frame)
+	{
+		input.Apply(frame, chip8->GetKeypad());
+
+		result.instructions += chip8->RunFrame().cycles;
+	}
+	result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	result.hash = chip8->GetVideoHash();
+	result.fault = chip8->GetFault();
+	result.faultAddress = chip8->GetFaultAddress();
+	return result;
+}
+
+// Run the whole corpus with one task per ROM, returns the wall time in seconds
+static double RunBatch(const std::vector<RomJob>& jobs, const BatchSettings& settings, unsigned int threadCount, std::vector<RomResult>& results)
+{
+	results.assign(jobs.size(), RomResult());
+
+	std::vector<WorkStealingPool::Task> tasks;
+	for (size_t i = 0; i < jobs.size(); ++i)
+	{
+		tasks.push_back([&, i]() { results[i] = RunRom(jobs[i], settings); });
+	}
+
+	WorkStealingPool pool(threadCount);
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	pool.Run(std::move(tasks));
+	return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+static uint64_t CountInstructions(const std::vector<RomResult>& results)
+{
+	uint64_t instructions = 0;
+	for (const RomResult& result : results)
+	{
+		instructions += result.instructions;
+	}
+	return instructions;
+}
+
+// Runs a corpus of ROMs on a work-stealing thread pool and reports throughput, display hash and faults per ROM
+// Returns 1 when a ROM failed to load or faulted
+// Usage: CHIP8-Batch <romsFolder | manifest.txt> [--frames N] [--cycles perFrame] [--threads N] [--repeat N] [--scaling]
+//                    [--seed N] [--profile vip|schip|xochip] [--no-fusion] [--jit]
+int main(int argc, char** argv)
+{
+	BatchSettings settings;
+	unsigned int threadCount = std::max(1U, std::thread::hardware_concurrency());
+	unsigned int repeat = 1;
+	bool scaling = false;
+
+	std::vector<std::string> positional;
+	for (int i = 1; i < argc; ++i)
+	{
+		std::string arg = argv[i];
+		bool hasValue = i + 1 < argc;
+		if (arg == "--frames" && hasValue)
+		{
+			settings.frames = std::stoull(argv[++i]);
+		}
+		else if (arg == "--cycles" && hasValue)
+		{
+			settings.cyclesPerFrame = static_cast<unsigned int>(std::stoul(argv[++i]));
+		}
+		else if (arg == "--threads" && hasValue)
+		{
+			threadCount = std::max(1U, static_cast<unsigned int>(std::stoul(argv[++i])));
+		}
+		else if (arg == "--repeat" && hasValue)
+		{
+			repeat = std::max(1U, static_cast<unsigned int>(std::stoul(argv[++i])));
+		}
+		else if (arg == "--seed" && hasValue)
+		{
+			settings.seed = static_cast<unsigned int>(std::stoul(argv[++i]));
+		}
+		else if (arg == "--profile" && hasValue)
+		{
+			std::string name = argv[++i];
+			if (!ParseQuirkProfile(name, settings.profile))
+			{
+				std::cerr << "Unknown quirk profile: " << name << std::endl;
+				return -1;
+			}
+		}
+		else if (arg == "--scaling")
+		{
+			scaling = true;
+		}
+		else if (arg == "--no-fusion")
+		{
+			settings.fusion = false;
+		}
+		else if (arg == "--jit")
+		{
+			settings.jit = true;
+		}
+		else
+		{
+			positional.push_back(arg);
+		}
+	}
+
+	if (positional.size() != 1)
+	{
+		std::cerr << "Usage: " << argv[0] << " <romsFolder | manifest.txt> [--frames N] [--cycles perFrame] [--threads N] [--repeat N]"
+			<< " [--scaling] [--seed N] [--profile vip|schip|xochip] [--no-fusion] [--jit]" << std::endl;
+		return -1;
+	}
+
+	std::vector<RomJob> corpus;
+	if (!LoadCorpus(positional[0], corpus))
+	{
+		return -1;
+	}
+	if (corpus.empty())
+	{
+		std::cerr << "No ROM found in " << positional[0] << std::endl;
+		return -1;
+	}
+
+	// Repeated runs give the pool enough tasks to measure scaling on a small corpus
+	std::vector<RomJob> jobs;
+	for (unsigned int i = 0; i < repeat; ++i)
+	{
+		jobs.insert(jobs.end(), corpus.begin(), corpus.end());
+	}
+
+	std::vector<RomResult> results;
+	double wallSeconds = RunBatch(jobs, settings, threadCount, results);
+
+	std::cout << std::left << std::setw(32) << "ROM" << std::right << std::setw(12) << "MIPS" << std::setw(20) << "Display hash" << "  Status" << std::endl;
+
+	unsigned int failures = 0;
+	for (size_t i = 0; i < corpus.size(); ++i)
+	{
+		const RomResult& result = results[i];
+		std::cout << std::left << std::setw(32) << std::filesystem::path(corpus[i].romPath).filename().string() << std::right;
+
+		if (!result.loaded)
+		{
+			std::cout << std::setw(12) << "-" << std::setw(20) << "-" << "  load failed" << std::endl;
+			++failures;
+			continue;
+		}
+
+		std::cout << std::setw(12) << std::fixed << std::setprecision(1) << result.instructions / result.seconds / 1e6
+			<< "    " << std::hex << std::setfill('0') << std::setw(16) << result.hash << std::setfill(' ') << std::dec;
+
+		// Every repetition must end in the same state
+		bool deterministic = true;
+		for (size_t j = i + corpus.size(); j < jobs.size(); j += corpus.size())
+		{
+			deterministic &= results[j].hash == result.hash && results[j].fault == result.fault;
+		}
+
+		if (result.fault != Chip8::Fault::None)
+		{
+			std::cout << "  " << Chip8::GetFaultName(result.fault) << " at 0x" << std::hex << result.faultAddress << std::dec;
+			++failures;
+		}
+		else
+		{
+			std::cout << "  ok";
+		}
+		if (!deterministic)
+		{
+			std::cout << ", repetitions differ";
+			++failures;
+		}
+		std::cout << std::endl;
+	}
+
+	std::cout << std::endl << jobs.size() << " runs on " << threadCount << " threads, " << failures << " failures, "
+		<< std::fixed << std::setprecision(1) << wallSeconds * 1000.0 << " ms, "
+		<< CountInstructions(results) / wallSeconds / 1e6 << " MIPS" << std::endl;
+
+	if (scaling)
+	{
+		std::cout << std::endl << std::left << std::setw(10) << "Threads" << std::right << std::setw(12) << "Time ms"
+			<< std::setw(12) << "MIPS" << std::setw(12) << "Speedup" << std::setw(12) << "Efficiency" << std::endl;
+
+		double baseSeconds = 0.0;
+		for (unsigned int threads = 1; threads <= threadCount; ++threads)
+		{
+			std::vector<RomResult> scaled;
+			double seconds = RunBatch(jobs, settings, threads, scaled);
+			if (threads == 1)
+			{
+				baseSeconds = seconds;
+			}
+
+			std::cout << std::left << std::setw(10) << threads << std::right << std::fixed
+				<< std::setw(12) << std::setprecision(1) << seconds * 1000.0
+				<< std::setw(12) << CountInstructions(scaled) / seconds / 1e6
+				<< std::setw(12) << std::setprecision(2) << baseSeconds / seconds
+				<< std::setw(11) << std::setprecision(0) << baseSeconds / seconds / threads * 100.0 << "%" << std::endl;
+		}
+	}
+
+	return failures > 0 ? 1 : 0;
+}
\ No newline at end of file
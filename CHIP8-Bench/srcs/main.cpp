@@ -0,0 +1,212 @@
+#include <algorithm>
+#include <chrono>
+#include <climits>
+#include <filesystem>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "Chip8.h"
+#include "Chip8Lockstep.h"
+
+// Aggregate throughput of the lockstep engine running every ROM on 1k to 64k instances
+// Every instance count takes the same number of steps, so all of them run the same part of the program
+static int RunLockstep(const std::vector<std::string>& roms, uint64_t cycles, QuirkProfile profile, bool simd, unsigned int tickCycles)
+{
+	static constexpr unsigned int INSTANCE_COUNTS[] = { 1024, 4096, 16384, 65536 };
+	uint64_t steps = std::max<uint64_t>(cycles / INSTANCE_COUNTS[std::size(INSTANCE_COUNTS) - 1], 1);
+
+	std::cout << std::left << std::setw(32) << "ROM (lockstep MIPS)" << std::right;
+	for (unsigned int instances : INSTANCE_COUNTS)
+	{
+		std::cout << std::setw(12) << instances;
+	}
+	std::cout << std::endl;
+
+	double totalSeconds[std::size(INSTANCE_COUNTS)] = {};
+	uint64_t totalInstructions[std::size(INSTANCE_COUNTS)] = {};
+	for (const std::string& rom : roms)
+	{
+		std::cout << std::left << std::setw(32) << std::filesystem::path(rom).filename().string() << std::right;
+		for (size_t i = 0; i < std::size(INSTANCE_COUNTS); ++i)
+		{
+			std::unique_ptr<Chip8Lockstep> lockstep = std::make_unique<Chip8Lockstep>(INSTANCE_COUNTS[i], profile);
+			if (!lockstep->SetSIMDEnabled(simd))
+			{
+				std::cerr << "AVX2 is not available on this host." << std::endl;
+				return -1;
+			}
+			lockstep->SetTickCycles(tickCycles);
+			if (!lockstep->LoadROM(rom))
+			{
+				return -1;
+			}
+
+			std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+			lockstep->Run(steps);
+			double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+			uint64_t instructions = steps * INSTANCE_COUNTS[i];
+			totalSeconds[i] += seconds;
+			totalInstructions[i] += instructions;
+			std::cout << std::setw(12) << std::fixed << std::setprecision(1) << instructions / seconds / 1e6;
+		}
+		std::cout << std::endl;
+	}
+
+	std::cout << std::left << std::setw(32) << "Total" << std::right;
+	for (size_t i = 0; i < std::size(INSTANCE_COUNTS); ++i)
+	{
+		std::cout << std::setw(12) << std::fixed << std::setprecision(1) << totalInstructions[i] / totalSeconds[i] / 1e6;
+	}
+	std::cout << std::endl;
+
+	return 0;
+}
+
+// Runs every ROM found in a folder for a fixed number of cycles and prints the interpreter throughput
+// Usage: CHIP8-Bench [romsFolder] [cycles] [--no-fusion] [--jit] [--aot] [--lockstep] [--no-simd] [--profile vip|schip|xochip]
+//                    [--tick-cycles N] [--call-graph]
+// --call-graph follows guest calls while running, to measure its cost against a run without it, it needs CHIP8_PROFILER
+// Idle loops are executed like any other code, the throughput is the one of the engines
+int main(int argc, char** argv)
+{
+	std::string romsFolder = "roms/";
+	uint64_t cycles = 50'000'000ULL;
+	bool fusion = true;
+	bool jit = false;
+	bool aot = false;
+	bool lockstep = false;
+	bool simd = true;
+	bool callGraph = false;
+	QuirkProfile profile = QuirkProfile::SuperChip;
+	// Instructions between timer ticks, also the longest slice an engine runs at once
+	unsigned int tickCycles = Chip8::DEFAULT_TICK_CYCLES;
+
+	std::vector<std::string> positional;
+	for (int i = 1; i < argc; ++i)
+	{
+		std::string arg = argv[i];
+		if (arg == "--no-fusion")
+		{
+			fusion = false;
+		}
+		else if (arg == "--jit")
+		{
+			jit = true;
+		}
+		else if (arg == "--aot")
+		{
+			aot = true;
+		}
+		else if (arg == "--lockstep")
+		{
+			lockstep = true;
+		}
+		else if (arg == "--no-simd")
+		{
+			simd = false;
+		}
+		else if (arg == "--call-graph")
+		{
+			callGraph = true;
+		}
+		else if (arg == "--profile" && i + 1 < argc)
+		{
+			std::string name = argv[++i];
+			if (!ParseQuirkProfile(name, profile))
+			{
+				std::cerr << "Unknown quirk profile: " << name << std::endl;
+				return -1;
+			}
+		}
+		else if (arg == "--tick-cycles" && i + 1 < argc)
+		{
+			tickCycles = static_cast<unsigned int>(std::stoul(argv[++i]));
+		}
+		else
+		{
+			positional.push_back(arg);
+		}
+	}
+	if (positional.size() > 0)
+	{
+		romsFolder = positional[0];
+	}
+	if (positional.size() > 1)
+	{
+		cycles = std::stoull(positional[1]);
+	}
+
+	if (!std::filesystem::exists(romsFolder) || !std::filesystem::is_directory(romsFolder))
+	{
+		std::cerr << "ROMs folder does not exist: " << romsFolder << std::endl;
+		return -1;
+	}
+
+	std::vector<std::string> roms;
+	for (const auto& entry : std::filesystem::directory_iterator(romsFolder))
+	{
+		if (entry.is_regular_file() && entry.path().extension() == ".ch8")
+		{
+			roms.push_back(entry.path().string());
+		}
+	}
+	std::sort(roms.begin(), roms.end());
+
+	if (lockstep)
+	{
+		return RunLockstep(roms, cycles, profile, simd, tickCycles);
+	}
+
+	std::cout << std::left << std::setw(32) << "ROM" << std::right << std::setw(12) << "MIPS" << std::endl;
+
+	double totalSeconds = 0.0;
+	for (const std::string& rom : roms)
+	{
+		std::unique_ptr<Chip8> chip8 = std::make_unique<Chip8>();
+		chip8->SetQuirkProfile(profile);
+		chip8->SetFusionEnabled(fusion);
+		chip8->SetTickCycles(tickCycles);
+		if (jit && !chip8->SetJITEnabled(true))
+		{
+			std::cerr << "JIT is not available on this host." << std::endl;
+			return -1;
+		}
+		chip8->SetCompiledROMsEnabled(aot);
+		if (callGraph && !chip8->SetCallGraphEnabled(true))
+		{
+			std::cerr << "Profiler not built in, configure with -DCHIP8_PROFILER=ON." << std::endl;
+			return -1;
+		}
+		if (!chip8->LoadROM(rom))
+		{
+			return -1;
+		}
+		if (aot && !chip8->IsRunningCompiledROM())
+		{
+			std::cerr << "No compiled code linked for " << rom << ", interpreting." << std::endl;
+		}
+
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		for (uint64_t i = 0; i < cycles;)
+		{
+			i += chip8->Cycle(static_cast<unsigned int>(std::min<uint64_t>(cycles - i, UINT_MAX)));
+		}
+		double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		totalSeconds += seconds;
+
+		std::cout << std::left << std::setw(32) << std::filesystem::path(rom).filename().string()
+			<< std::right << std::setw(12) << std::fixed << std::setprecision(1) << cycles / seconds / 1e6 << std::endl;
+	}
+
+	if (!roms.empty())
+	{
+		std::cout << std::left << std::setw(32) << "Total" << std::right << std::setw(12) << std::fixed << std::setprecision(1)
+			<< cycles * roms.size() / totalSeconds / 1e6 << std::endl;
+	}
+
+	return 0;
+}
\ No newline at end of file
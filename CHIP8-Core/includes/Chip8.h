@@ -0,0 +1,420 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <type_traits>
+
+#include "Chip8Quirks.h"
+#include "Chip8Recompiled.h"
+
+class Chip8CallGraph;
+class Chip8JIT;
+class Chip8Profiler;
+
+class Chip8
+{
+	friend class Chip8JIT;
+	friend class Chip8Lockstep;
+	friend class Chip8Recompiled;
+
+public:
+	// Program errors, execution goes on but the first one is kept until the next ROM load
+	enum class Fault : uint8_t
+	{
+		None,
+		// Opcode with no defined operation, including the 0nnn machine code calls
+		InvalidOpcode,
+		// 2nnn with every stack level in use
+		StackOverflow,
+		// 00EE with an empty stack
+		StackUnderflow
+	};
+
+	// What happened during a batch of instructions, all a frontend needs to know once per frame
+	struct RunResult
+	{
+		// Instructions retired
+		unsigned int cycles = 0;
+		// Instructions of idle loops skipped without being executed, counted in cycles
+		unsigned int haltedCycles = 0;
+		bool displayChanged = false;
+		// The sound timer was running at some point of the batch
+		bool soundActive = false;
+		// The sound timer was stopped when the batch began and ran during it
+		bool soundStarted = false;
+		// The sound timer ran during the batch and was stopped when it ended
+		bool soundStopped = false;
+		// The batch ended on Fx0A with no key held
+		bool waitingForKey = false;
+	};
+
+	Chip8();
+	~Chip8();
+
+	bool LoadROM(const std::string& filename);
+	// Execute the instruction at PC, or a fused sequence of at most budget instructions
+	// A call never runs past the next timer tick, which fires once its last instruction retired
+	// Returns the number of CHIP-8 instructions retired
+	unsigned int Cycle(unsigned int budget = 1);
+	// Execute exactly cycles instructions in one call
+	// Key waits and jumps to self are fast-forwarded to the end of the batch, delay timer polls to the next tick,
+	// the machine ends in the same state as if they had been executed
+	RunResult RunCycles(unsigned int cycles);
+	// Execute instructions up to and including the next timer tick, one frame of emulated time
+	RunResult RunFrame() { return RunCycles(GetCyclesToTick()); }
+	// True when the instruction at PC is Fx0A and no key is held
+	bool IsWaitingForKey() const;
+
+	// Instructions per timer tick, the instruction rate is 60 times this number per second of emulated time
+	// Changing it starts a new tick period at the current instruction
+	void SetTickCycles(unsigned int cycles);
+	unsigned int GetTickCycles() const { return tickCycles; }
+	// Instructions retired since the ROM was loaded
+	uint64_t GetCycleCount() const { return state.cycles; }
+	// Instructions left until the next timer tick fires
+	unsigned int GetCyclesToTick() const { return static_cast<unsigned int>(state.nextTick - state.cycles); }
+
+	// Toggle superinstruction fusion, the whole instruction cache is rebuilt
+	void SetFusionEnabled(bool enabled);
+	bool IsFusionEnabled() const { return fusionEnabled; }
+
+	// Toggle the x86-64 JIT, returns false when it is not available on this host
+	bool SetJITEnabled(bool enabled);
+	bool IsJITEnabled() const { return jit != nullptr; }
+
+	// Toggle running ROMs translated ahead of time by CHIP8-Recompiler, when one matching the loaded ROM is linked in
+	void SetCompiledROMsEnabled(bool enabled);
+	bool IsRunningCompiledROM() const { return compiledROM != nullptr; }
+
+	// Toggle counting instructions per opcode class and address, every instruction is interpreted while it counts
+	// Returns false when the core was built without CHIP8_PROFILER, the profile is cleared on every ROM load
+	bool SetProfilerEnabled(bool enabled);
+	// nullptr while the profiler is disabled
+	const Chip8Profiler* GetProfiler() const { return profiler.get(); }
+	// Toggle following 2nnn and 00EE to attribute instructions to guest subroutines, native code is bypassed while it follows them
+	// Returns false when the core was built without CHIP8_PROFILER, the call graph is cleared on every ROM load
+	bool SetCallGraphEnabled(bool enabled);
+	// nullptr while the call graph is disabled
+	const Chip8CallGraph* GetCallGraph() const { return callGraph.get(); }
+	// Clear the profile and the call graph, the call graph keeps the subroutines running
+	void ResetProfiler();
+
+	// Select the handlers instantiated for a quirk profile, the whole instruction cache is rebuilt
+	void SetQuirkProfile(QuirkProfile profile);
+	QuirkProfile GetQuirkProfile() const { return quirkProfile; }
+
+	uint8_t* GetKeypad() { return state.keypad; }
+	const uint8_t* GetKeypad() const { return state.keypad; }
+	// Reseed the Cxnn random generator, seeded from the clock by default
+	void SetRandomSeed(unsigned int seed) { state.randState = SeedRandom(seed); }
+
+	// One row per line, bit 63 is the leftmost pixel
+	const uint64_t* GetVideo() const { return state.video; }
+	// FNV-1a over the display rows, stable across hosts
+	uint64_t GetVideoHash() const { return HashVideo(state.video); }
+	static uint64_t HashVideo(const uint64_t* video);
+	// FNV-1a over the ROM file as it was loaded, 0 when none is
+	// Not affected by the ROM writing over itself, a savestate restores the hash of the ROM it was saved with
+	uint64_t GetROMHash() const { return romHash; }
+	uint8_t GetSoundTimer() const { return state.soundTimer; }
+	uint8_t* GetRegisters() { return state.registers; }
+
+	Fault GetFault() const { return state.fault; }
+	// Address of the instruction that raised the fault
+	uint16_t GetFaultAddress() const { return state.faultAddress; }
+	static const char* GetFaultName(Fault fault);
+
+	// xorshift32 generator behind Cxnn, the state must never be 0
+	static uint32_t SeedRandom(unsigned int seed)
+	{
+		uint32_t randState = seed * 2654435761U + 0x9E3779B9U;
+		return randState != 0 ? randState : 1;
+	}
+	static uint8_t NextRandomByte(uint32_t& randState)
+	{
+		randState ^= randState << 13;
+		randState ^= randState >> 17;
+		randState ^= randState << 5;
+		return static_cast<uint8_t>(randState >> 24);
+	}
+
+public:
+#pragma region Static Variables
+	static constexpr unsigned int START_ADDRESS = 0x200;
+
+	static constexpr unsigned int FONTSET_SIZE = 80;
+	static constexpr unsigned int FONTSET_START_ADDRESS = 0x50;
+
+	static constexpr unsigned int KEY_COUNT = 16;
+	static constexpr unsigned int MEMORY_SIZE = 4096;
+	static constexpr unsigned int REGISTER_COUNT = 16;
+	static constexpr unsigned int STACK_LEVELS = 16;
+	static constexpr unsigned int VIDEO_HEIGHT = 32;
+	static constexpr unsigned int VIDEO_WIDTH = 64;
+
+	// Delay and sound timers count down at this rate
+	static constexpr unsigned int TIMER_FREQUENCY = 60;
+	// About 660 instructions per second
+	static constexpr unsigned int DEFAULT_TICK_CYCLES = 11;
+	static_assert(VIDEO_WIDTH == 64, "Display rows are stored as 64-bit words");
+#pragma endregion
+
+	// Complete mutable machine state, trivially copyable so that an instance can be cloned or saved with a plain copy
+	// The registers, PC, I, SP, timers and scheduler share the first cache line
+	struct alignas(64) State
+	{
+		uint8_t registers[REGISTER_COUNT];
+		uint16_t pc;
+		uint16_t index;
+		uint8_t sp;
+		uint8_t delayTimer;
+		uint8_t soundTimer;
+		Fault fault;
+		uint16_t faultAddress;
+		uint32_t randState;
+		// Instructions retired and the count at which the next timer tick fires
+		uint64_t cycles;
+		uint64_t nextTick;
+		uint8_t keypad[KEY_COUNT];
+		uint16_t stack[STACK_LEVELS];
+		// Display, one bit per pixel
+		uint64_t video[VIDEO_HEIGHT];
+		uint8_t memory[MEMORY_SIZE];
+	};
+	static_assert(std::is_trivially_copyable_v<State>, "State is copied as raw bytes");
+	static_assert(offsetof(State, nextTick) < 64, "Hot registers must fit in the first cache line");
+
+	const State& GetState() const { return state; }
+	// Restore a state taken from any instance running the same quirk profile
+	// Instructions over memory that differs are decoded and translated again, compiled code is kept only if memory still matches the ROM
+	void SetState(const State& snapshot);
+
+	// Versioned binary savestate: magic, version, quirk profile, ROM size and hash, then every State field in little-endian order
+	static constexpr uint16_t SAVE_STATE_VERSION = 2;
+	static constexpr size_t SAVE_STATE_HEADER_SIZE = 4 + sizeof(uint16_t) + sizeof(uint8_t) + sizeof(uint16_t) + sizeof(uint64_t);
+	static constexpr size_t SAVE_STATE_SIZE = SAVE_STATE_HEADER_SIZE + REGISTER_COUNT + 2 * sizeof(uint16_t) + 4 * sizeof(uint8_t)
+		+ sizeof(uint16_t) + sizeof(uint32_t) + 2 * sizeof(uint64_t) + KEY_COUNT + STACK_LEVELS * sizeof(uint16_t)
+		+ VIDEO_HEIGHT * sizeof(uint64_t) + MEMORY_SIZE;
+	// Write SAVE_STATE_SIZE bytes to buffer
+	void SaveState(uint8_t* buffer) const;
+	// Restore a savestate written by SaveState, switching to its quirk profile
+	// Returns false and leaves the machine untouched when the data is truncated, from another version or inconsistent
+	bool LoadState(const uint8_t* buffer, size_t size);
+
+private:
+	struct Instruction;
+	// The instruction is the decoded slot itself, a handler writing memory over its own code gets it re-decoded:
+	// every field it needs is read before it calls InvalidateDecoded
+	using Chip8Func = void (Chip8::*)(const Instruction&);
+
+	// Fully decoded instruction: handler plus every operand field pre-extracted from the opcode
+	// Fused handlers keep the operands of their first instruction and span length instructions
+	struct Instruction
+	{
+		Chip8Func handler;
+		uint16_t nnn;
+		uint8_t x;
+		uint8_t y;
+		uint8_t n;
+		uint8_t nn;
+		uint8_t length;
+	};
+
+	// Longest superinstruction, in bytes
+	static constexpr unsigned int MAX_FUSED_BYTES = 6;
+	// SetState compares memory in blocks of this size
+	static constexpr unsigned int STATE_COMPARE_BYTES = 64;
+
+	void ResetHardware();
+	// Scheduled event: decrement the timers and schedule the next tick
+	void TickTimers();
+	// Same as count instructions leaving the timers alone, firing the ticks they cross
+	void AdvanceCycles(unsigned int count);
+	// Run the engines on a slice that does not cross a tick: compiled code, translated code, then the interpreter
+	unsigned int ExecuteSlice(unsigned int budget);
+	// ExecuteSlice for the interpreter alone, counting what it retires, only built with CHIP8_PROFILER
+	unsigned int ProfileSlice(unsigned int budget);
+	// Point the call graph at the subroutines on the machine stack
+	void RebuildCallStack();
+	// Fast-forward through the idle loop entered by the last instruction, up to budget instructions
+	// Returns the number of instructions skipped
+	unsigned int SkipHalt(unsigned int budget);
+	// Record a fault raised by the instruction being executed, PC already points past it
+	void RaiseFault(Fault raised);
+
+#pragma region Opcode Table
+	// Returns the shared table holding the decoded form of all 65536 opcodes for a profile, built on first use
+	static const Instruction* GetOpcodeTable(QuirkProfile profile);
+	template <Chip8Quirks Quirks>
+	static const Instruction* GetOpcodeTable();
+	template <Chip8Quirks Quirks>
+	static Chip8Func Decode(uint16_t opcode);
+#pragma endregion
+
+#pragma region Instruction Cache
+	// Read the big-endian opcode stored at address, wrapping around the address space
+	uint16_t FetchOpcode(unsigned int address) const;
+	// Re-decode every slot whose opcode overlaps the count bytes written at address
+	// The slot of the running handler may be one of them, so its instruction must not be read afterwards
+	void InvalidateDecoded(unsigned int address, unsigned int count);
+	void DecodeAll();
+	// Decode a single slot, fusing it with the following instructions when they form a known idiom
+	void DecodeSlot(unsigned int address);
+#pragma endregion
+
+#pragma region Operation Codes
+	// Do nothing but raise an invalid opcode fault, used for unimplemented or reserved opcodes
+	void OP_NULL(const Instruction& ins);
+
+	// Clear the display
+	void OP_00E0(const Instruction& ins);
+	// Return from a subroutine
+	void OP_00EE(const Instruction& ins);
+	// Jump to a specific address
+	void OP_1nnn(const Instruction& ins);
+	// Call a subroutine at a specific address
+	void OP_2nnn(const Instruction& ins);
+	// Skip the next instruction if Vx equals nn
+	void OP_3xnn(const Instruction& ins);
+	// Skip the next instruction if Vx does not equal nn
+	void OP_4xnn(const Instruction& ins);
+	// Skip the next instruction if Vx equals Vy
+	void OP_5xy0(const Instruction& ins);
+	// Set Vx to nn
+	void OP_6xnn(const Instruction& ins);
+	// Add nn to Vx
+	void OP_7xnn(const Instruction& ins);
+	// Set Vx to the value of Vy
+	void OP_8xy0(const Instruction& ins);
+	// Set Vx to Vx OR Vy
+	template <Chip8Quirks Quirks>
+	void OP_8xy1(const Instruction& ins);
+	// Set Vx to Vx AND Vy
+	template <Chip8Quirks Quirks>
+	void OP_8xy2(const Instruction& ins);
+	// Set Vx to Vx XOR Vy
+	template <Chip8Quirks Quirks>
+	void OP_8xy3(const Instruction& ins);
+	// Add Vy to Vx, set carry if overflow
+	void OP_8xy4(const Instruction& ins);
+	// Subtract Vy from Vx, set carry if no overflow
+	void OP_8xy5(const Instruction& ins);
+	// Shift Vx (or Vy) right by 1, set VF to the bit shifted out
+	template <Chip8Quirks Quirks>
+	void OP_8xy6(const Instruction& ins);
+	// Set Vx to Vy minus Vx, set carry if no overflow
+	void OP_8xy7(const Instruction& ins);
+	// Shift Vx (or Vy) left by 1, set VF to the bit shifted out
+	template <Chip8Quirks Quirks>
+	void OP_8xyE(const Instruction& ins);
+	// Skip the next instruction if Vx does not equal Vy
+	void OP_9xy0(const Instruction& ins);
+	// Set I to the address nnn
+	void OP_Annn(const Instruction& ins);
+	// Jump to the address nnn plus V0, or xnn plus Vx
+	template <Chip8Quirks Quirks>
+	void OP_Bnnn(const Instruction& ins);
+	// Set Vx to a random number AND nn
+	void OP_Cxnn(const Instruction& ins);
+	// Draw a sprite at coordinates (Vx, Vy) with n bytes of sprite data
+	template <Chip8Quirks Quirks>
+	void OP_Dxyn(const Instruction& ins);
+	// Skip the next instruction if the key corresponding to Vx is pressed
+	void OP_Ex9E(const Instruction& ins);
+	// Skip the next instruction if the key corresponding to Vx is not pressed
+	void OP_ExA1(const Instruction& ins);
+	// Set Vx to the value of the delay timer
+	void OP_Fx07(const Instruction& ins);
+	// Wait for a key press and store the value in Vx
+	void OP_Fx0A(const Instruction& ins);
+	// Set the delay timer to the value of Vx
+	void OP_Fx15(const Instruction& ins);
+	// Set the sound timer to the value of Vx
+	void OP_Fx18(const Instruction& ins);
+	// Add Vx to I
+	void OP_Fx1E(const Instruction& ins);
+	// Set I to the address of the sprite for the character in Vx
+	void OP_Fx29(const Instruction& ins);
+	// Store the binary-coded decimal representation of Vx in memory starting at I
+	void OP_Fx33(const Instruction& ins);
+	// Store the values of V0 to Vx in memory starting at I
+	template <Chip8Quirks Quirks>
+	void OP_Fx55(const Instruction& ins);
+	// Load the values from memory starting at I into V0 to Vx
+	template <Chip8Quirks Quirks>
+	void OP_Fx65(const Instruction& ins);
+#pragma endregion
+
+#pragma region Superinstructions
+	// Set I then draw a sprite
+	void OP_Annn_Dxyn(const Instruction& ins);
+	// Load two registers with immediates
+	void OP_6xnn_6xnn(const Instruction& ins);
+	// Poll the delay timer: Vx = DT, skip if Vx == nn, otherwise jump back to the poll
+	void OP_Fx07_3xnn_1nnn(const Instruction& ins);
+	// Increment a counter and skip if it reached nn
+	void OP_7xnn_3xnn(const Instruction& ins);
+#pragma endregion
+
+private:
+	static constexpr uint8_t fontset[FONTSET_SIZE] =
+	{
+		0xF0, 0x90, 0x90, 0x90, 0xF0, // 0
+		0x20, 0x60, 0x20, 0x20, 0x70, // 1
+		0xF0, 0x10, 0xF0, 0x80, 0xF0, // 2
+		0xF0, 0x10, 0xF0, 0x10, 0xF0, // 3
+		0x90, 0x90, 0xF0, 0x10, 0x10, // 4
+		0xF0, 0x80, 0xF0, 0x10, 0xF0, // 5
+		0xF0, 0x80, 0xF0, 0x90, 0xF0, // 6
+		0xF0, 0x10, 0x20, 0x40, 0x40, // 7
+		0xF0, 0x90, 0xF0, 0x90, 0xF0, // 8
+		0xF0, 0x90, 0xF0, 0x10, 0xF0, // 9
+		0xF0, 0x90, 0xF0, 0x90, 0x90, // A
+		0xE0, 0x90, 0xE0, 0x90, 0xE0, // B
+		0xF0, 0x80, 0x80, 0x80, 0xF0, // C
+		0xE0, 0x90, 0x90, 0x90, 0xE0, // D
+		0xF0, 0x80, 0xF0, 0x80, 0xF0, // E
+		0xF0, 0x80, 0xF0, 0x80, 0x80  // F
+	};
+
+
+	// CHIP-8 hardware specifications
+	State state;
+
+	// Shared decoded opcode table of the selected quirk profile
+	QuirkProfile quirkProfile = QuirkProfile::SuperChip;
+	const Instruction* opcodeTable;
+	// Predecoded instruction for every address, even and odd, kept in sync with memory writes
+	Instruction decoded[MEMORY_SIZE];
+	bool fusionEnabled = true;
+	unsigned int tickCycles = DEFAULT_TICK_CYCLES;
+	// Instructions retired by the current Cycle, fused handlers lower it when they exit early
+	unsigned int retired = 0;
+
+	// Idle loops recognised by the handlers, consumed by RunCycles
+	enum class Halt : uint8_t
+	{
+		None,
+		// Fx0A with no key held
+		KeyWait,
+		// 1nnn jumping to itself
+		SelfJump,
+		// Fx07, 3xnn, 1nnn looping until the delay timer reads nn, only recognised when fusion is enabled
+		DelayPoll
+	};
+	Halt halt = Halt::None;
+
+	// Optional native code engine, falls back to the interpreter for what it cannot translate
+	std::unique_ptr<Chip8JIT> jit;
+
+	// Ahead of time compiled version of the loaded ROM, dropped when the ROM overwrites its code
+	const Chip8Recompiled::CompiledROM* compiledROM = nullptr;
+	bool compiledROMsEnabled = false;
+	size_t romSize = 0;
+	uint64_t romHash = 0;
+
+	std::unique_ptr<Chip8Profiler> profiler;
+	std::unique_ptr<Chip8CallGraph> callGraph;
+};
\ No newline at end of file
@@ -0,0 +1,132 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "Chip8.h"
+
+// Shadow call stack following 2nnn and 00EE, the instructions retired are attributed to the guest subroutine running them.
+// Every distinct chain of calls is a node of a call tree, written out as folded stacks for flame graph tools:
+// one "main;0x2A4;0x31C count" line per chain, count being the instructions retired in its innermost subroutine.
+// Nothing is done per instruction, the instructions between two calls or returns are attributed at the second one.
+// Filled by the interpreter when the core is built with CHIP8_PROFILER, see Chip8::SetCallGraphEnabled.
+class Chip8CallGraph
+{
+public:
+	// Chains beyond this many distinct ones are attributed to their caller
+	static constexpr size_t MAX_NODES = 1 << 16;
+	static constexpr unsigned int SUMMARY_SUBROUTINES = 16;
+
+	// Subroutine by entry address: calls, instructions retired in it, and in it or anything it called
+	struct Subroutine
+	{
+		uint16_t address;
+		uint64_t calls;
+		uint64_t selfCycles;
+		uint64_t totalCycles;
+	};
+
+	// Plain copy of the hottest subroutines, small enough to publish every frame
+	// The code outside any subroutine is listed at the ROM entry address
+	struct Summary
+	{
+		uint64_t cycles;
+		Subroutine subroutines[SUMMARY_SUBROUTINES];
+		unsigned int subroutineCount;
+		unsigned int depth;
+		size_t nodeCount;
+	};
+
+	explicit Chip8CallGraph(uint64_t cycles);
+
+	// cycles is the instruction count of the machine once the call or return retired,
+	// the call is attributed to the caller and the return to the subroutine it leaves
+	void Call(uint16_t address, uint64_t cycles)
+	{
+		Advance(cycles);
+		if (depth == Chip8::STACK_LEVELS)
+		{
+			// The machine stack wraps, returns balance these calls first
+			++overflowCalls;
+			return;
+		}
+		Enter(address, cycles);
+		++nodes[frames[depth].node].calls;
+		++addressCalls[address & (Chip8::MEMORY_SIZE - 1)];
+	}
+	void Return(uint64_t cycles)
+	{
+		Advance(cycles);
+		if (overflowCalls > 0)
+		{
+			--overflowCalls;
+		}
+		else if (depth > 0)
+		{
+			Leave(cycles);
+		}
+	}
+	// Attribute what ran up to cycles, before the machine leaves that point of its run
+	void Flush(uint64_t cycles) { Advance(cycles); }
+	// Follow the machine to another point of its run, entries lists the subroutine of each stack level, outermost first
+	// The instructions in between are not attributed, Flush first to keep those before it
+	void Rebuild(const uint16_t* entries, unsigned int count, uint64_t cycles);
+	// Forget every count, the call stack stays where it is
+	void Clear(uint64_t cycles);
+
+	// cycles is the instruction count of the machine now, what ran since the last call or return is included
+	void Summarize(Summary& summary, uint64_t cycles) const;
+	// Chains that retired no instruction are left out
+	void WriteFolded(std::ostream& out, const std::string& rootName, uint64_t cycles) const;
+
+private:
+	struct Node
+	{
+		uint16_t address;
+		uint32_t parent;
+		uint32_t firstChild;
+		uint32_t nextSibling;
+		uint64_t calls;
+		uint64_t selfCycles;
+	};
+
+	struct Frame
+	{
+		uint32_t node;
+		uint64_t entryCycles;
+	};
+
+	static constexpr uint32_t NO_NODE = UINT32_MAX;
+
+	// Attribute the instructions retired since the last event to the subroutine running
+	void Advance(uint64_t cycles)
+	{
+		uint64_t elapsed = cycles > lastCycles ? cycles - lastCycles : 0;
+		lastCycles = cycles;
+		Node& node = nodes[frames[depth].node];
+		node.selfCycles += elapsed;
+		addressSelfCycles[node.address & (Chip8::MEMORY_SIZE - 1)] += elapsed;
+	}
+	// Push the node of address under the running one
+	void Enter(uint16_t address, uint64_t cycles);
+	// Pop the running subroutine, its time counts for its address unless it is also further up the stack
+	void Leave(uint64_t cycles);
+	bool IsOnStackBelow(uint16_t address, unsigned int level) const;
+
+private:
+	// nodes[0] is the code outside any subroutine, children always follow their parent
+	std::vector<Node> nodes;
+	// frames[0] is the root, frames[depth] the subroutine running
+	Frame frames[Chip8::STACK_LEVELS + 1];
+	unsigned int depth = 0;
+	unsigned int overflowCalls = 0;
+	uint64_t lastCycles = 0;
+
+	// Per entry address, totalCycles of the frames still on the stack is added when summarizing
+	uint64_t addressCalls[Chip8::MEMORY_SIZE] = {};
+	uint64_t addressSelfCycles[Chip8::MEMORY_SIZE] = {};
+	uint64_t addressTotalCycles[Chip8::MEMORY_SIZE] = {};
+};
\ No newline at end of file
@@ -0,0 +1,99 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <vector>
+
+class Chip8;
+
+// Translates CHIP-8 basic blocks into x86-64 machine code operating directly on a Chip8 instance.
+// Blocks are chained on 1nnn and 2nnn, anything that cannot be translated (Dxyn, Fx0A, memory writes...)
+// is left to the interpreter. Translated code is flushed whenever a write touches a translated byte.
+class Chip8JIT
+{
+public:
+	explicit Chip8JIT(Chip8& chip8);
+	~Chip8JIT();
+
+	Chip8JIT(const Chip8JIT&) = delete;
+	Chip8JIT& operator=(const Chip8JIT&) = delete;
+
+	// True when the host is x86-64 and executable memory could be allocated
+	bool IsAvailable() const { return code != nullptr; }
+
+	// Run translated blocks starting at PC for at most budget instructions
+	// Returns the number of instructions retired, 0 when the interpreter must execute the next instruction
+	unsigned int Execute(unsigned int budget);
+
+	// Drop translated code overlapping the count bytes written at address
+	void Invalidate(unsigned int address, unsigned int count);
+	// Drop every translated block
+	void Flush();
+
+private:
+	using EntryFunc = unsigned int (*)(Chip8* chip8, unsigned int budget, const uint8_t* block);
+
+	uint8_t* Translate(unsigned int address);
+	// Link pending jumps to the block that was just translated at address
+	void LinkPending(unsigned int address, uint8_t* block);
+	// Switch the code buffer between writable and executable, only when it is not already
+	bool SetWritable(bool enabled);
+
+#pragma region Emitter
+	void Emit8(uint8_t value);
+	void Emit16(uint16_t value);
+	void Emit32(uint32_t value);
+	// Emit an opcode whose ModRM operand is [rbx + disp32]
+	void EmitMem(std::initializer_list<uint8_t> opcode, uint8_t reg, int32_t displacement);
+	// Emit a rel32 jump or conditional jump, returns the position of the rel32 field
+	size_t EmitJump(uint8_t condition, const uint8_t* target);
+	void PatchJump(size_t position, const uint8_t* target);
+
+	// Account for retired instructions, store PC and leave through the exit stub or a chained block
+	void EmitExit(unsigned int retired, unsigned int target);
+	void EmitDynamicExit(unsigned int retired);
+#pragma endregion
+
+private:
+	static constexpr size_t CODE_SIZE = 1 << 20;
+	// Free space required before translating another block
+	static constexpr size_t BLOCK_RESERVE = 16 * 1024;
+	static constexpr unsigned int MAX_BLOCK_INSTRUCTIONS = 64;
+
+	Chip8& chip8;
+
+	// Offsets of the machine state from the Chip8 instance, addressed through rbx in generated code
+	int32_t registersOffset;
+	int32_t memoryOffset;
+	int32_t indexOffset;
+	int32_t pcOffset;
+	int32_t stackOffset;
+	int32_t spOffset;
+	int32_t delayTimerOffset;
+	int32_t soundTimerOffset;
+	int32_t keypadOffset;
+
+	// Executable code buffer, starting with the entry and exit stubs
+	// Writable while blocks are translated, executable while they run
+	uint8_t* code = nullptr;
+	bool writable = true;
+	size_t codeUsed = 0;
+	size_t stubsSize = 0;
+	EntryFunc enter = nullptr;
+	const uint8_t* exitStub = nullptr;
+
+	// Block entry point per CHIP-8 address
+	std::vector<uint8_t*> blocks;
+	// Addresses where translation failed, left to the interpreter until the next flush
+	std::vector<bool> untranslatable;
+	// Bytes of CHIP-8 memory read by translated code
+	std::vector<bool> translatedBytes;
+
+	struct PendingLink
+	{
+		size_t position;
+		unsigned int target;
+	};
+	std::vector<PendingLink> pendingLinks;
+};
\ No newline at end of file
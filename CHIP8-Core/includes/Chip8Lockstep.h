@@ -0,0 +1,128 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "Chip8.h"
+
+// Runs many CHIP-8 machines in lockstep, every Step executes exactly one instruction on each of them.
+// Machine state is stored as structure of arrays and lanes are processed in blocks of BLOCK_LANES.
+// The lanes of a block sharing an opcode execute it as one group: with AVX2 for register, timer, jump and call operations
+// as well as random numbers and key tests while no key is held, one lane at a time for memory writes and drawing.
+// A block whose lanes diverged runs one masked group per distinct opcode.
+// Results match a Chip8 running the same ROM with fusion disabled and the same tick cycles, one Cycle per Step.
+class Chip8Lockstep
+{
+public:
+	static constexpr unsigned int BLOCK_LANES = 32;
+	// Bounded by the 32-bit offsets of the AVX2 opcode gather
+	static constexpr unsigned int MAX_INSTANCES = 1 << 19;
+
+	// instanceCount is rounded up to whole blocks, the extra lanes run like the others
+	explicit Chip8Lockstep(unsigned int instanceCount, QuirkProfile profile = QuirkProfile::SuperChip);
+
+	// Reset every instance and load the same ROM in each of them
+	bool LoadROM(const std::string& filename);
+
+	// Execute one instruction on every instance
+	void Step();
+	// Same as calling Step steps times, but each block runs all its steps while its state is in cache
+	void Run(uint64_t steps);
+
+	// Toggle the AVX2 path, returns false when the host does not support it
+	bool SetSIMDEnabled(bool enabled);
+	bool IsSIMDEnabled() const { return simdEnabled; }
+
+	unsigned int GetInstanceCount() const { return instanceCount; }
+	// Steps per timer tick, see Chip8::SetTickCycles
+	void SetTickCycles(unsigned int cycles);
+	unsigned int GetTickCycles() const { return tickCycles; }
+	// Lane random generators are seeded with their lane number until reseeded
+	void SetRandomSeed(unsigned int lane, unsigned int seed) { randStates[lane] = Chip8::SeedRandom(seed); }
+
+	uint8_t* GetKeypad(unsigned int lane) { return &keypad[lane * Chip8::KEY_COUNT]; }
+	const uint64_t* GetVideo(unsigned int lane) const { return &video[lane * Chip8::VIDEO_HEIGHT]; }
+	uint64_t GetVideoHash(unsigned int lane) const { return Chip8::HashVideo(GetVideo(lane)); }
+	uint8_t GetMemory(unsigned int lane, unsigned int address) const { return memory[(address & (Chip8::MEMORY_SIZE - 1)) * laneCount + lane]; }
+	uint8_t GetRegister(unsigned int lane, unsigned int reg) const { return registers[reg * laneCount + lane]; }
+	uint16_t GetPC(unsigned int lane) const { return pc[lane]; }
+	uint16_t GetIndex(unsigned int lane) const { return index[lane]; }
+
+	// Opcode groups executed so far, the number of steps times the number of blocks while lanes never diverge
+	uint64_t GetGroupCount() const { return groupCount; }
+
+private:
+	using Operation = Chip8Recompiled::Operation;
+
+	// Operation and operand fields of the opcode shared by a group of lanes
+	struct Group
+	{
+		Operation operation;
+		uint16_t nnn;
+		uint8_t x;
+		uint8_t y;
+		uint8_t n;
+		uint8_t nn;
+	};
+
+	// Operation of every opcode, built on first use
+	static const Operation* GetOperationTable();
+
+	void ResetLane(unsigned int lane, const std::vector<uint8_t>& rom);
+
+	// Every function below works on the block of lanes starting at base, mask selects lanes within it
+	// Timers tick after the step when tick is set
+	void StepBlock(unsigned int base, const Operation* operations, bool tick);
+	void FetchBlock(unsigned int base);
+	uint32_t MatchOpcode(unsigned int base, uint16_t opcode) const;
+	void ExecuteGroup(unsigned int base, uint32_t mask, const Group& group);
+	void ExecuteLane(unsigned int lane, const Group& group);
+	void TickTimers(unsigned int base);
+
+#pragma region AVX2
+	void FetchBlockAVX2(unsigned int base);
+	uint32_t MatchOpcodeAVX2(unsigned int base, uint16_t opcode) const;
+	// Returns false when the operation has no vector form, or not for these lanes, and must run lane by lane
+	bool ExecuteGroupAVX2(unsigned int base, uint32_t mask, const Group& group);
+	void TickTimersAVX2(unsigned int base);
+	// True when no lane of the block holds a key
+	bool AreKeysReleasedAVX2(unsigned int base) const;
+	// True when every lane in mask has the same stack pointer, returned in level
+	bool IsStackUniformAVX2(unsigned int base, uint32_t mask, uint8_t& level) const;
+#pragma endregion
+
+private:
+	unsigned int instanceCount;
+	unsigned int laneCount;
+	// Quirks are tested once per group, not once per lane
+	Chip8Quirks quirks;
+	bool simdEnabled = false;
+	uint64_t groupCount = 0;
+	// Every lane retires one instruction per step, so one countdown to the next timer tick serves them all
+	unsigned int tickCycles = Chip8::DEFAULT_TICK_CYCLES;
+	unsigned int stepsToTick = Chip8::DEFAULT_TICK_CYCLES;
+
+	// Indexed [reg * laneCount + lane] so a block of one register is contiguous
+	std::vector<uint8_t> registers;
+	// Indexed [address * laneCount + lane], lanes at the same PC fetch their opcodes from two contiguous blocks
+	// Padded for the 4-byte gathers of the last lane
+	std::vector<uint8_t> memory;
+	std::vector<uint16_t> index;
+	std::vector<uint16_t> pc;
+	// Indexed [level * laneCount + lane]
+	std::vector<uint16_t> stack;
+	std::vector<uint8_t> sp;
+	std::vector<uint8_t> delayTimer;
+	std::vector<uint8_t> soundTimer;
+	// Indexed [lane * KEY_COUNT + key]
+	std::vector<uint8_t> keypad;
+	// Indexed [lane * VIDEO_HEIGHT + row]
+	std::vector<uint64_t> video;
+
+	// Same generator as Chip8, one state per lane
+	std::vector<uint32_t> randStates;
+
+	// Opcode fetched by each lane for the current step
+	std::vector<uint16_t> opcodes;
+};
\ No newline at end of file
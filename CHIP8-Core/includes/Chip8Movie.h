@@ -0,0 +1,75 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "Chip8.h"
+
+// Input movie: every keypad change of a run with the instruction it happened at, enough to reproduce the run exactly.
+// A run starts from a freshly loaded ROM with a known random seed, so the movie holds no machine state.
+// Binary format, little-endian: magic, version, quirk profile, tick cycles, seed, ROM hash, length in instructions,
+// final display hash and event count, then per keypad change the instructions since the previous one as a varint
+// followed by the 16-bit keypad mask.
+class Chip8Movie
+{
+public:
+	static constexpr uint16_t VERSION = 1;
+
+	// Start recording chip8, which must have just loaded its ROM and been seeded with seed
+	// Returns false when instructions already ran
+	bool StartRecording(const Chip8& chip8, uint32_t seed);
+	// Record the keypad after a change, the instruction count of chip8 says when it happened
+	void Record(const Chip8& chip8);
+	// Forget what was recorded after the current instruction, after chip8 went back in time
+	void Truncate(const Chip8& chip8);
+	// End the recording at the current instruction, the display is kept to check replays against
+	void StopRecording(const Chip8& chip8);
+	bool IsRecording() const { return recording; }
+
+	// Prepare chip8, with the movie ROM just loaded, to replay: selects the quirk profile, tick cycles and seed
+	// Returns false when the loaded ROM is not the one the movie was recorded with
+	bool StartReplay(Chip8& chip8);
+	// Run up to cycles instructions, applying the keypad changes when their instruction is reached
+	// Stops at the end of the movie, IsReplayFinished then returns true
+	Chip8::RunResult Replay(Chip8& chip8, unsigned int cycles);
+	bool IsReplayFinished(const Chip8& chip8) const { return chip8.GetCycleCount() >= length; }
+	// True when the display at the end of the replay matches the one recorded
+	bool IsInSync(const Chip8& chip8) const { return chip8.GetVideoHash() == videoHash; }
+
+	void Serialize(std::vector<uint8_t>& data) const;
+	bool Deserialize(const uint8_t* data, size_t size);
+	bool Save(const std::string& filename) const;
+	bool Load(const std::string& filename);
+
+	QuirkProfile GetQuirkProfile() const { return profile; }
+	unsigned int GetTickCycles() const { return tickCycles; }
+	// Instructions from the ROM load to the end of the recording
+	uint64_t GetLength() const { return length; }
+	size_t GetEventCount() const { return events.size(); }
+
+private:
+	struct Event
+	{
+		uint64_t cycle;
+		uint16_t keypad;
+	};
+
+	static uint16_t PackKeypad(const uint8_t* keypad);
+
+private:
+	QuirkProfile profile = QuirkProfile::SuperChip;
+	unsigned int tickCycles = Chip8::DEFAULT_TICK_CYCLES;
+	uint32_t seed = 0;
+	uint64_t romHash = 0;
+	uint64_t length = 0;
+	uint64_t videoHash = 0;
+	// In instruction order, several changes at one instruction are merged into the last
+	std::vector<Event> events;
+
+	bool recording = false;
+	uint16_t recordedKeypad = 0;
+	// Next event to apply while replaying
+	size_t nextEvent = 0;
+};
\ No newline at end of file
@@ -0,0 +1,97 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+
+#include "Chip8.h"
+
+// Execution profile of a Chip8: instructions retired per opcode class and per address, backward jumps as loops,
+// and the host time spent drawing sprites.
+// Filled by the interpreter when the core is built with CHIP8_PROFILER, see Chip8::SetProfilerEnabled.
+class Chip8Profiler
+{
+public:
+	// Every opcode with a defined operation, then the invalid ones
+	static constexpr unsigned int OPCODE_CLASS_COUNT = 35;
+	static constexpr unsigned int INVALID_OPCODE_CLASS = OPCODE_CLASS_COUNT - 1;
+	static constexpr unsigned int SUMMARY_HOTSPOTS = 16;
+	static constexpr unsigned int SUMMARY_LOOPS = 8;
+
+	// Instruction at an address and how many times it retired
+	struct Hotspot
+	{
+		uint16_t address;
+		uint16_t opcode;
+		uint64_t executions;
+	};
+
+	// Backward jump from end to start, instructions counts everything retired between them
+	struct Loop
+	{
+		uint16_t start;
+		uint16_t end;
+		uint64_t iterations;
+		uint64_t instructions;
+	};
+
+	// Plain copy of the busiest parts of the profile, small enough to publish every frame
+	struct Summary
+	{
+		uint64_t instructions;
+		uint64_t opcodeExecutions[OPCODE_CLASS_COUNT];
+		Hotspot hotspots[SUMMARY_HOTSPOTS];
+		unsigned int hotspotCount;
+		Loop loops[SUMMARY_LOOPS];
+		unsigned int loopCount;
+		uint64_t drawNS;
+	};
+
+	static unsigned int GetOpcodeClass(uint16_t opcode);
+	// Opcode pattern, such as 8xy4
+	static const char* GetOpcodeClassName(unsigned int opcodeClass);
+
+	// Count executions of the instruction at address
+	void Count(uint16_t address, uint16_t opcode, uint64_t executions = 1)
+	{
+		address &= Chip8::MEMORY_SIZE - 1;
+		opcodeExecutions[GetOpcodeClass(opcode)] += executions;
+		addressExecutions[address] += executions;
+		addressOpcodes[address] = opcode;
+		instructions += executions;
+	}
+	// Count iterations of the loop closed by a backward jump at end
+	void CountLoop(uint16_t end, uint16_t start, uint64_t iterations = 1)
+	{
+		end &= Chip8::MEMORY_SIZE - 1;
+		loopIterations[end] += iterations;
+		loopStarts[end] = start & (Chip8::MEMORY_SIZE - 1);
+	}
+	void AddDrawTime(uint64_t ns) { drawNS += ns; }
+	void Reset();
+
+	uint64_t GetInstructionCount() const { return instructions; }
+	uint64_t GetOpcodeExecutions(unsigned int opcodeClass) const { return opcodeExecutions[opcodeClass]; }
+	uint64_t GetAddressExecutions(uint16_t address) const { return addressExecutions[address & (Chip8::MEMORY_SIZE - 1)]; }
+	uint64_t GetDrawNS() const { return drawNS; }
+
+	void Summarize(Summary& summary) const;
+	// One row per opcode class, address and loop executed, busiest first within each section
+	void WriteCSV(std::ostream& out) const;
+
+private:
+	// Busiest first, at most count of them
+	size_t GetHotspots(Hotspot* hotspots, size_t count) const;
+	size_t GetLoops(Loop* loops, size_t count) const;
+
+private:
+	uint64_t instructions = 0;
+	uint64_t opcodeExecutions[OPCODE_CLASS_COUNT] = {};
+	uint64_t addressExecutions[Chip8::MEMORY_SIZE] = {};
+	// Last opcode retired at each address, a ROM may rewrite its code
+	uint16_t addressOpcodes[Chip8::MEMORY_SIZE] = {};
+	// Indexed by the address of the backward jump
+	uint64_t loopIterations[Chip8::MEMORY_SIZE] = {};
+	uint16_t loopStarts[Chip8::MEMORY_SIZE] = {};
+	uint64_t drawNS = 0;
+};
\ No newline at end of file
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <string>
+
+// Behaviours that differ between CHIP-8 implementations
+// Handlers are instantiated once per profile, so none of these is tested while running
+struct Chip8Quirks
+{
+	// 8xy6 and 8xyE shift Vy into Vx instead of shifting Vx in place
+	bool shiftUsesVy;
+	// Fx55 and Fx65 leave I pointing past the last register transferred
+	bool loadStoreIncrementsIndex;
+	// Bnnn jumps to xnn + Vx instead of nnn + V0
+	bool jumpUsesVx;
+	// Dxyn wraps sprites around the screen edges instead of clipping them
+	bool spritesWrap;
+	// 8xy1, 8xy2 and 8xy3 reset VF
+	bool logicResetsVF;
+};
+
+enum class QuirkProfile
+{
+	CosmacVIP,
+	SuperChip,
+	XOChip
+};
+
+inline constexpr Chip8Quirks COSMAC_VIP_QUIRKS = { true, true, false, false, true };
+inline constexpr Chip8Quirks SUPER_CHIP_QUIRKS = { false, false, true, false, false };
+inline constexpr Chip8Quirks XO_CHIP_QUIRKS = { true, true, false, true, false };
+
+constexpr const Chip8Quirks& GetQuirks(QuirkProfile profile)
+{
+	switch (profile)
+	{
+	case QuirkProfile::CosmacVIP: return COSMAC_VIP_QUIRKS;
+	case QuirkProfile::XOChip: return XO_CHIP_QUIRKS;
+	default: return SUPER_CHIP_QUIRKS;
+	}
+}
+
+// Parse a profile from its command line name: vip, schip or xochip
+inline bool ParseQuirkProfile(const std::string& name, QuirkProfile& profile)
+{
+	if (name == "vip")
+	{
+		profile = QuirkProfile::CosmacVIP;
+	}
+	else if (name == "schip")
+	{
+		profile = QuirkProfile::SuperChip;
+	}
+	else if (name == "xochip")
+	{
+		profile = QuirkProfile::XOChip;
+	}
+	else
+	{
+		return false;
+	}
+	return true;
+}
\ No newline at end of file
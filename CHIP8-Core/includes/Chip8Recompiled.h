@@ -0,0 +1,70 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "Chip8Quirks.h"
+
+class Chip8;
+
+// Runtime support for ROMs translated ahead of time to C++ by CHIP8-Recompiler.
+// Generated translation units register themselves here and reach the machine state through this class.
+class Chip8Recompiled
+{
+public:
+	// Runs at most budget instructions starting at PC, returns the number retired
+	// 0 means PC is not a recovered instruction and the interpreter must execute it
+	using RunFunc = unsigned int (*)(Chip8& chip8, unsigned int budget);
+
+	struct CompiledROM
+	{
+		const char* name;
+		const uint8_t* image;
+		size_t size;
+		// One bit per address decoded as code, a write there hands the ROM back to the interpreter
+		const uint8_t* codeMap;
+		// Quirk profile the code was generated for
+		QuirkProfile profile;
+		RunFunc run;
+	};
+
+	// Registers a compiled ROM during static initialization
+	struct Registrar
+	{
+		explicit Registrar(const CompiledROM& rom);
+	};
+
+	// Returns the compiled ROM built from exactly this image for this profile, if any was linked in
+	static const CompiledROM* Find(const uint8_t* image, size_t size, QuirkProfile profile);
+
+	// Machine state as seen by generated code
+	struct State
+	{
+		uint8_t* registers;
+		uint8_t* memory;
+		uint16_t& index;
+		uint16_t& pc;
+		uint16_t* stack;
+		uint8_t& sp;
+		uint8_t& delayTimer;
+		uint8_t& soundTimer;
+		uint8_t* keypad;
+	};
+	static State GetState(Chip8& chip8);
+
+	// Run one instruction through the interpreter handlers, PC must already point past it
+	static void Execute(Chip8& chip8, uint16_t opcode);
+	// False once the program wrote over its own compiled code
+	static bool IsActive(const Chip8& chip8);
+
+	// Operation an opcode decodes to, matching the interpreter decoder exactly, whatever the quirk profile
+	enum class Operation
+	{
+		OP_NULL,
+		OP_00E0, OP_00EE, OP_1nnn, OP_2nnn, OP_3xnn, OP_4xnn, OP_5xy0, OP_6xnn, OP_7xnn,
+		OP_8xy0, OP_8xy1, OP_8xy2, OP_8xy3, OP_8xy4, OP_8xy5, OP_8xy6, OP_8xy7, OP_8xyE,
+		OP_9xy0, OP_Annn, OP_Bnnn, OP_Cxnn, OP_Dxyn, OP_Ex9E, OP_ExA1,
+		OP_Fx07, OP_Fx0A, OP_Fx15, OP_Fx18, OP_Fx1E, OP_Fx29, OP_Fx33, OP_Fx55, OP_Fx65
+	};
+	static Operation GetOperation(uint16_t opcode);
+};
\ No newline at end of file
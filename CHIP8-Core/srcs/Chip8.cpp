@@ -0,0 +1,1317 @@
+#include "Chip8.h"
+#include "Chip8CallGraph.h"
+#include "Chip8JIT.h"
+#include "Chip8Profiler.h"
+
+#include <algorithm>
+#include <bit>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <vector>
+
+namespace
+{
+	constexpr uint8_t SAVE_STATE_MAGIC[4] = { 'C', '8', 'S', 'T' };
+
+	// Savestate fields are little-endian whatever the host
+	template <typename T>
+	uint8_t* StoreField(uint8_t* out, T value)
+	{
+		for (size_t i = 0; i < sizeof(T); ++i)
+		{
+			*out++ = static_cast<uint8_t>(value >> (8 * i));
+		}
+		return out;
+	}
+
+	template <typename T>
+	const uint8_t* LoadField(const uint8_t* in, T& value)
+	{
+		value = 0;
+		for (size_t i = 0; i < sizeof(T); ++i)
+		{
+			value |= static_cast<T>(static_cast<T>(*in++) << (8 * i));
+		}
+		return in;
+	}
+
+	// Arrays are a plain copy on little-endian hosts
+	template <typename T>
+	uint8_t* StoreArray(uint8_t* out, const T* values, size_t count)
+	{
+		if constexpr (std::endian::native == std::endian::little)
+		{
+			memcpy(out, values, count * sizeof(T));
+			return out + count * sizeof(T);
+		}
+		for (size_t i = 0; i < count; ++i)
+		{
+			out = StoreField(out, values[i]);
+		}
+		return out;
+	}
+
+	template <typename T>
+	const uint8_t* LoadArray(const uint8_t* in, T* values, size_t count)
+	{
+		if constexpr (std::endian::native == std::endian::little)
+		{
+			memcpy(values, in, count * sizeof(T));
+			return in + count * sizeof(T);
+		}
+		for (size_t i = 0; i < count; ++i)
+		{
+			in = LoadField(in, values[i]);
+		}
+		return in;
+	}
+}
+
+Chip8::Chip8()
+	: opcodeTable(GetOpcodeTable(quirkProfile))
+{
+	// Seed the random generator from the clock, resets keep it running
+	state.randState = SeedRandom(static_cast<unsigned int>(std::chrono::system_clock::now().time_since_epoch().count()));
+
+	ResetHardware();
+}
+
+Chip8::~Chip8() = default;
+
+bool Chip8::LoadROM(const std::string& filename)
+{
+	ResetHardware();
+
+	std::ifstream file(filename, std::ios::binary | std::ios::ate);
+	if (file)
+	{
+		std::streamsize size = file.tellg();
+		file.seekg(0, std::ios::beg);
+
+		std::vector<char> buffer(size);
+		if (file.read(buffer.data(), size))
+		{
+			// Load the ROM into memory starting at address 0x200
+			for (std::streamsize i = 0; i < size; ++i)
+			{
+				// Prevent overflow
+				if (START_ADDRESS + i >= MEMORY_SIZE)
+				{
+					std::cerr << "ROM size exceeds memory limit." << std::endl;
+					return false;
+				}
+				state.memory[START_ADDRESS + i] = static_cast<uint8_t>(buffer[i]);
+			}
+			romSize = static_cast<size_t>(size);
+
+			romHash = 14695981039346656037ULL;
+			for (char byte : buffer)
+			{
+				romHash ^= static_cast<uint8_t>(byte);
+				romHash *= 1099511628211ULL;
+			}
+		}
+		else
+		{
+			std::cerr << "Failed to read ROM data from file: " << filename << std::endl;
+			return false;
+		}
+	}
+	else
+	{
+		// Failed to open the file
+		std::cerr << "Failed to load ROM: " << filename << std::endl;
+		return false;
+	}
+
+	// ResetHardware decoded the cleared memory, only the slots over the ROM changed since
+	InvalidateDecoded(START_ADDRESS, static_cast<unsigned int>(romSize));
+
+	SetCompiledROMsEnabled(compiledROMsEnabled);
+
+	return true;
+}
+
+unsigned int Chip8::Cycle(unsigned int budget)
+{
+	// Timers only change on ticks, so every engine sees them hold still during a slice
+	budget = static_cast<unsigned int>(std::min<uint64_t>(budget, state.nextTick - state.cycles));
+
+	unsigned int executed = ExecuteSlice(budget);
+	state.cycles += executed;
+	if (state.cycles >= state.nextTick)
+	{
+		TickTimers();
+	}
+
+	return executed;
+}
+
+unsigned int Chip8::ExecuteSlice(unsigned int budget)
+{
+#if CHIP8_PROFILER
+	if (profiler)
+	{
+		return ProfileSlice(budget);
+	}
+	// Native code would call and return without the call graph seeing it
+	bool interpretOnly = callGraph != nullptr;
+#else
+	constexpr bool interpretOnly = false;
+#endif
+
+	// Run compiled or translated code first, the interpreter takes over for what they left
+	if (compiledROM && !interpretOnly)
+	{
+		unsigned int compiledRetired = compiledROM->run(*this, budget);
+		if (compiledRetired > 0)
+		{
+			return compiledRetired;
+		}
+	}
+
+	if (jit && !interpretOnly)
+	{
+		unsigned int jitRetired = jit->Execute(budget);
+		if (jitRetired > 0)
+		{
+			return jitRetired;
+		}
+	}
+
+	// Fetch the predecoded instruction, PC is wrapped to the address space
+	const Instruction* instruction = &decoded[state.pc & (MEMORY_SIZE - 1)];
+
+	// A fused sequence that does not fit in the budget runs its first instruction alone
+	if (instruction->length > budget)
+	{
+		instruction = &opcodeTable[FetchOpcode(state.pc)];
+	}
+
+	// Increment the program counter
+	state.pc += 2;
+
+	// Execute the opcode
+	retired = instruction->length;
+	(this->*instruction->handler)(*instruction);
+
+	return retired;
+}
+
+Chip8::RunResult Chip8::RunCycles(unsigned int cycles)
+{
+	RunResult result;
+	halt = Halt::None;
+
+	uint64_t previousVideo[VIDEO_HEIGHT];
+	memcpy(previousVideo, state.video, sizeof(state.video));
+	bool soundWasActive = state.soundTimer > 0;
+	result.soundActive = soundWasActive;
+
+	// Sound is sampled between calls, a fused sequence or a compiled block retires several instructions at once
+	while (result.cycles < cycles)
+	{
+		result.cycles += Cycle(cycles - result.cycles);
+		result.soundActive |= state.soundTimer > 0;
+
+		if (halt != Halt::None)
+		{
+			unsigned int skipped = SkipHalt(cycles - result.cycles);
+			result.cycles += skipped;
+			result.haltedCycles += skipped;
+		}
+	}
+
+	result.displayChanged = memcmp(previousVideo, state.video, sizeof(state.video)) != 0;
+	result.soundStarted = !soundWasActive && result.soundActive;
+	result.soundStopped = result.soundActive && state.soundTimer == 0;
+	result.waitingForKey = IsWaitingForKey();
+	return result;
+}
+
+unsigned int Chip8::SkipHalt(unsigned int budget)
+{
+	unsigned int skipped = 0;
+	switch (halt)
+	{
+	case Halt::KeyWait:
+	case Halt::SelfJump:
+		// Keys only change between batches, the same instruction would run until the end of this one
+		skipped = budget;
+		break;
+	case Halt::DelayPoll:
+	{
+		// The delay timer holds still until the next tick, every whole iteration before it reads the same value
+		const Instruction& poll = decoded[state.pc & (MEMORY_SIZE - 1)];
+		const uint8_t nn = decoded[(state.pc + 2) & (MEMORY_SIZE - 1)].nn;
+		if (state.delayTimer != nn)
+		{
+			unsigned int untilTick = static_cast<unsigned int>(state.nextTick - state.cycles);
+			skipped = std::min(budget, untilTick) / 3 * 3;
+			if (skipped > 0)
+			{
+				state.registers[poll.x] = state.delayTimer;
+			}
+		}
+		break;
+	}
+	case Halt::None:
+		break;
+	}
+
+#if CHIP8_PROFILER
+	if (profiler && skipped > 0)
+	{
+		// Skipped iterations count as if they had run
+		uint16_t address = state.pc & (MEMORY_SIZE - 1);
+		if (halt == Halt::DelayPoll)
+		{
+			for (unsigned int i = 0; i < 3; ++i)
+			{
+				profiler->Count(address + 2 * i, FetchOpcode(address + 2 * i), skipped / 3);
+			}
+			profiler->CountLoop(address + 4, address, skipped / 3);
+		}
+		else
+		{
+			profiler->Count(address, FetchOpcode(address), skipped);
+			if (halt == Halt::SelfJump)
+			{
+				profiler->CountLoop(address, address, skipped);
+			}
+		}
+	}
+#endif
+
+	halt = Halt::None;
+	AdvanceCycles(skipped);
+	return skipped;
+}
+
+#if CHIP8_PROFILER
+unsigned int Chip8::ProfileSlice(unsigned int budget)
+{
+	uint16_t address = state.pc & (MEMORY_SIZE - 1);
+	const Instruction* instruction = &decoded[address];
+	if (instruction->length > budget)
+	{
+		instruction = &opcodeTable[FetchOpcode(address)];
+	}
+
+	// Fetched before running, Fx33 and Fx55 may write over their own opcode
+	// Fused sequences never write memory, the opcodes after the first are still the ones that ran
+	const uint16_t opcode = FetchOpcode(address);
+
+	// Only sprite drawing is timed, a set-I-then-draw pair is timed whole
+	bool draw = (opcode & 0xF000) == 0xD000 || instruction->handler == &Chip8::OP_Annn_Dxyn;
+	std::chrono::steady_clock::time_point drawStart;
+	if (draw)
+	{
+		drawStart = std::chrono::steady_clock::now();
+	}
+
+	state.pc += 2;
+	retired = instruction->length;
+	(this->*instruction->handler)(*instruction);
+
+	if (draw)
+	{
+		profiler->AddDrawTime(static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+			std::chrono::steady_clock::now() - drawStart).count()));
+	}
+
+	// A fused sequence is straight-line code, its instructions follow each other in memory
+	for (unsigned int i = 0; i < retired; ++i)
+	{
+		uint16_t instructionAddress = (address + 2 * i) & (MEMORY_SIZE - 1);
+		profiler->Count(instructionAddress, i == 0 ? opcode : FetchOpcode(instructionAddress));
+	}
+
+	// A jump back closes a loop, calls and returns going back do not
+	uint16_t last = (address + 2 * (retired - 1)) & (MEMORY_SIZE - 1);
+	uint16_t target = state.pc & (MEMORY_SIZE - 1);
+	uint16_t operation = (retired == 1 ? opcode : FetchOpcode(last)) & 0xF000;
+	if (target <= last && (operation == 0x1000 || operation == 0xB000))
+	{
+		profiler->CountLoop(last, target);
+	}
+	return retired;
+}
+#endif
+
+bool Chip8::SetProfilerEnabled(bool enabled)
+{
+#if CHIP8_PROFILER
+	if (!enabled)
+	{
+		profiler.reset();
+	}
+	else if (!profiler)
+	{
+		profiler = std::make_unique<Chip8Profiler>();
+	}
+	return true;
+#else
+	return !enabled;
+#endif
+}
+
+bool Chip8::SetCallGraphEnabled(bool enabled)
+{
+#if CHIP8_PROFILER
+	if (!enabled)
+	{
+		callGraph.reset();
+	}
+	else if (!callGraph)
+	{
+		// Enabled mid-run, the subroutines already running are found from the stack
+		callGraph = std::make_unique<Chip8CallGraph>(state.cycles);
+		RebuildCallStack();
+	}
+	return true;
+#else
+	return !enabled;
+#endif
+}
+
+void Chip8::ResetProfiler()
+{
+	if (profiler)
+	{
+		profiler->Reset();
+	}
+	if (callGraph)
+	{
+		callGraph->Clear(state.cycles);
+	}
+}
+
+void Chip8::RebuildCallStack()
+{
+	// Each level holds the return address, the call before it names the subroutine
+	uint16_t entries[STACK_LEVELS];
+	unsigned int count = std::min<unsigned int>(state.sp, STACK_LEVELS);
+	if (state.sp >= 0x80)
+	{
+		// Only returning below the bottom of the stack wraps this far, calling past the top stays well under it,
+		// the slots left there are no calls, as when following returns
+		count = 0;
+	}
+	for (unsigned int level = 0; level < count; ++level)
+	{
+		uint16_t call = FetchOpcode(state.stack[level] - 2);
+		entries[level] = (call & 0xF000) == 0x2000 ? call & 0x0FFF : state.stack[level];
+	}
+	callGraph->Rebuild(entries, count, state.cycles);
+}
+
+bool Chip8::IsWaitingForKey() const
+{
+	if (opcodeTable[FetchOpcode(state.pc)].handler != &Chip8::OP_Fx0A)
+	{
+		return false;
+	}
+
+	for (unsigned int i = 0; i < KEY_COUNT; ++i)
+	{
+		if (state.keypad[i] != 0)
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+void Chip8::SetFusionEnabled(bool enabled)
+{
+	fusionEnabled = enabled;
+	DecodeAll();
+}
+
+bool Chip8::SetJITEnabled(bool enabled)
+{
+	if (!enabled)
+	{
+		jit.reset();
+		return true;
+	}
+
+	if (!jit)
+	{
+		jit = std::make_unique<Chip8JIT>(*this);
+		if (!jit->IsAvailable())
+		{
+			jit.reset();
+			return false;
+		}
+	}
+	return true;
+}
+
+void Chip8::SetCompiledROMsEnabled(bool enabled)
+{
+	compiledROMsEnabled = enabled;
+	compiledROM = enabled && romSize > 0 ? Chip8Recompiled::Find(state.memory + START_ADDRESS, romSize, quirkProfile) : nullptr;
+}
+
+void Chip8::SetQuirkProfile(QuirkProfile profile)
+{
+	quirkProfile = profile;
+	opcodeTable = GetOpcodeTable(profile);
+	DecodeAll();
+
+	// Compiled code is specific to the profile it was generated for
+	SetCompiledROMsEnabled(compiledROMsEnabled);
+}
+
+void Chip8::SetState(const State& snapshot)
+{
+	if (callGraph)
+	{
+		callGraph->Flush(state.cycles);
+	}
+
+	// Only the instructions over memory that differs are decoded again,
+	// restoring a recent snapshot of the same instance is little more than a copy
+	bool memoryChanged = false;
+	for (unsigned int address = 0; address < MEMORY_SIZE; address += STATE_COMPARE_BYTES)
+	{
+		if (memcmp(state.memory + address, snapshot.memory + address, STATE_COMPARE_BYTES) != 0)
+		{
+			memcpy(state.memory + address, snapshot.memory + address, STATE_COMPARE_BYTES);
+			InvalidateDecoded(address, STATE_COMPARE_BYTES);
+			memoryChanged = true;
+		}
+	}
+	state = snapshot;
+
+	// Compiled code is looked up again against the restored memory
+	if (memoryChanged)
+	{
+		SetCompiledROMsEnabled(compiledROMsEnabled);
+	}
+
+	if (callGraph)
+	{
+		RebuildCallStack();
+	}
+}
+
+void Chip8::SaveState(uint8_t* buffer) const
+{
+	uint8_t* out = buffer;
+	memcpy(out, SAVE_STATE_MAGIC, sizeof(SAVE_STATE_MAGIC));
+	out += sizeof(SAVE_STATE_MAGIC);
+	out = StoreField(out, SAVE_STATE_VERSION);
+	out = StoreField(out, static_cast<uint8_t>(quirkProfile));
+	out = StoreField(out, static_cast<uint16_t>(romSize));
+	out = StoreField(out, romHash);
+
+	out = StoreArray(out, state.registers, REGISTER_COUNT);
+	out = StoreField(out, state.pc);
+	out = StoreField(out, state.index);
+	out = StoreField(out, state.sp);
+	out = StoreField(out, state.delayTimer);
+	out = StoreField(out, state.soundTimer);
+	out = StoreField(out, static_cast<uint8_t>(state.fault));
+	out = StoreField(out, state.faultAddress);
+	out = StoreField(out, state.randState);
+	out = StoreField(out, state.cycles);
+	out = StoreField(out, state.nextTick);
+	out = StoreArray(out, state.keypad, KEY_COUNT);
+	out = StoreArray(out, state.stack, STACK_LEVELS);
+	out = StoreArray(out, state.video, VIDEO_HEIGHT);
+	StoreArray(out, state.memory, MEMORY_SIZE);
+}
+
+bool Chip8::LoadState(const uint8_t* buffer, size_t size)
+{
+	if (size < sizeof(SAVE_STATE_MAGIC) + sizeof(uint16_t) || memcmp(buffer, SAVE_STATE_MAGIC, sizeof(SAVE_STATE_MAGIC)) != 0)
+	{
+		std::cerr << "Not a savestate." << std::endl;
+		return false;
+	}
+
+	// The version comes first, the size of the rest depends on it
+	const uint8_t* in = buffer + sizeof(SAVE_STATE_MAGIC);
+	uint16_t version;
+	in = LoadField(in, version);
+	if (version != SAVE_STATE_VERSION)
+	{
+		std::cerr << "Unsupported savestate version: " << version << std::endl;
+		return false;
+	}
+	if (size != SAVE_STATE_SIZE)
+	{
+		std::cerr << "Truncated savestate." << std::endl;
+		return false;
+	}
+
+	uint8_t profile;
+	uint16_t savedROMSize;
+	uint64_t savedROMHash;
+	in = LoadField(in, profile);
+	in = LoadField(in, savedROMSize);
+	in = LoadField(in, savedROMHash);
+
+	// Decoded into a copy first, a rejected savestate leaves the machine as it was
+	State snapshot;
+	uint8_t fault;
+	in = LoadArray(in, snapshot.registers, REGISTER_COUNT);
+	in = LoadField(in, snapshot.pc);
+	in = LoadField(in, snapshot.index);
+	in = LoadField(in, snapshot.sp);
+	in = LoadField(in, snapshot.delayTimer);
+	in = LoadField(in, snapshot.soundTimer);
+	in = LoadField(in, fault);
+	in = LoadField(in, snapshot.faultAddress);
+	in = LoadField(in, snapshot.randState);
+	in = LoadField(in, snapshot.cycles);
+	in = LoadField(in, snapshot.nextTick);
+	in = LoadArray(in, snapshot.keypad, KEY_COUNT);
+	in = LoadArray(in, snapshot.stack, STACK_LEVELS);
+	in = LoadArray(in, snapshot.video, VIDEO_HEIGHT);
+	LoadArray(in, snapshot.memory, MEMORY_SIZE);
+	snapshot.fault = static_cast<Fault>(fault);
+
+	if (profile > static_cast<uint8_t>(QuirkProfile::XOChip) || fault > static_cast<uint8_t>(Fault::StackUnderflow)
+		|| snapshot.nextTick <= snapshot.cycles || snapshot.randState == 0 || START_ADDRESS + savedROMSize > MEMORY_SIZE)
+	{
+		std::cerr << "Corrupted savestate." << std::endl;
+		return false;
+	}
+	// The tick period is not saved, like SetTickCycles the next tick is at most one current period away
+	// A larger gap, from a state saved at a lower speed or a damaged file, would run one very long frame
+	snapshot.nextTick = std::min(snapshot.nextTick, snapshot.cycles + tickCycles);
+
+	if (quirkProfile != static_cast<QuirkProfile>(profile))
+	{
+		SetQuirkProfile(static_cast<QuirkProfile>(profile));
+	}
+	bool romChanged = romSize != savedROMSize || romHash != savedROMHash;
+	romSize = savedROMSize;
+	romHash = savedROMHash;
+	SetState(snapshot);
+	if (romChanged)
+	{
+		SetCompiledROMsEnabled(compiledROMsEnabled);
+	}
+	return true;
+}
+
+void Chip8::TickTimers()
+{
+	// Update timers
+	if (state.delayTimer > 0)
+	{
+		--state.delayTimer;
+	}
+
+	// Update sound timer
+	if (state.soundTimer)
+	{
+		--state.soundTimer;
+	}
+
+	state.nextTick += tickCycles;
+}
+
+void Chip8::AdvanceCycles(unsigned int count)
+{
+	state.cycles += count;
+	if (state.cycles >= state.nextTick)
+	{
+		uint64_t ticks = 1 + (state.cycles - state.nextTick) / tickCycles;
+		state.delayTimer = static_cast<uint8_t>(state.delayTimer - std::min<uint64_t>(state.delayTimer, ticks));
+		state.soundTimer = static_cast<uint8_t>(state.soundTimer - std::min<uint64_t>(state.soundTimer, ticks));
+		state.nextTick += ticks * tickCycles;
+	}
+}
+
+void Chip8::SetTickCycles(unsigned int cycles)
+{
+	tickCycles = std::max(cycles, 1U);
+	state.nextTick = state.cycles + tickCycles;
+}
+
+uint64_t Chip8::HashVideo(const uint64_t* video)
+{
+	uint64_t hash = 14695981039346656037ULL;
+	for (unsigned int y = 0; y < VIDEO_HEIGHT; ++y)
+	{
+		for (int shift = 56; shift >= 0; shift -= 8)
+		{
+			hash ^= (video[y] >> shift) & 0xFF;
+			hash *= 1099511628211ULL;
+		}
+	}
+	return hash;
+}
+
+const char* Chip8::GetFaultName(Fault fault)
+{
+	switch (fault)
+	{
+	case Fault::InvalidOpcode: return "invalid opcode";
+	case Fault::StackOverflow: return "stack overflow";
+	case Fault::StackUnderflow: return "stack underflow";
+	default: return "none";
+	}
+}
+
+void Chip8::RaiseFault(Fault raised)
+{
+	if (state.fault == Fault::None)
+	{
+		state.fault = raised;
+		state.faultAddress = static_cast<uint16_t>((state.pc - 2) & (MEMORY_SIZE - 1));
+	}
+}
+
+void Chip8::ResetHardware()
+{
+	// Clear registers, memory, stack, timers, display, keypad and fault, the random generator carries on
+	uint32_t randState = state.randState;
+	state = State{};
+	state.randState = randState;
+
+	// Reload fonts
+	memcpy(state.memory + FONTSET_START_ADDRESS, fontset, FONTSET_SIZE);
+
+	state.pc = START_ADDRESS;
+	state.nextTick = tickCycles;
+
+	// Forget the previous ROM
+	compiledROM = nullptr;
+	romSize = 0;
+	romHash = 0;
+	if (profiler)
+	{
+		profiler->Reset();
+	}
+	if (callGraph)
+	{
+		callGraph = std::make_unique<Chip8CallGraph>(state.cycles);
+	}
+
+	DecodeAll();
+}
+
+#pragma region Opcode Table
+const Chip8::Instruction* Chip8::GetOpcodeTable(QuirkProfile profile)
+{
+	switch (profile)
+	{
+	case QuirkProfile::CosmacVIP: return GetOpcodeTable<COSMAC_VIP_QUIRKS>();
+	case QuirkProfile::XOChip: return GetOpcodeTable<XO_CHIP_QUIRKS>();
+	default: return GetOpcodeTable<SUPER_CHIP_QUIRKS>();
+	}
+}
+
+template <Chip8Quirks Quirks>
+const Chip8::Instruction* Chip8::GetOpcodeTable()
+{
+	// Built once per profile and shared by every instance
+	static const std::vector<Instruction> table = []()
+	{
+		std::vector<Instruction> decoded(0xFFFF + 1);
+		for (uint32_t opcode = 0; opcode <= 0xFFFF; ++opcode)
+		{
+			Instruction& instruction = decoded[opcode];
+			instruction.handler = Decode<Quirks>(static_cast<uint16_t>(opcode));
+			instruction.nnn = opcode & 0x0FFF;
+			instruction.x = (opcode & 0x0F00) >> 8;
+			instruction.y = (opcode & 0x00F0) >> 4;
+			instruction.n = opcode & 0x000F;
+			instruction.nn = opcode & 0x00FF;
+			instruction.length = 1;
+		}
+		return decoded;
+	}();
+
+	return table.data();
+}
+
+template <Chip8Quirks Quirks>
+Chip8::Chip8Func Chip8::Decode(uint16_t opcode)
+{
+	switch ((opcode & 0xF000) >> 12)
+	{
+	case 0x0:
+		switch (opcode)
+		{
+		case 0x00E0: return &Chip8::OP_00E0;
+		case 0x00EE: return &Chip8::OP_00EE;
+		default: return &Chip8::OP_NULL;
+		}
+	case 0x1: return &Chip8::OP_1nnn;
+	case 0x2: return &Chip8::OP_2nnn;
+	case 0x3: return &Chip8::OP_3xnn;
+	case 0x4: return &Chip8::OP_4xnn;
+	case 0x5: return &Chip8::OP_5xy0;
+	case 0x6: return &Chip8::OP_6xnn;
+	case 0x7: return &Chip8::OP_7xnn;
+	case 0x8:
+		switch (opcode & 0x000F)
+		{
+		case 0x0: return &Chip8::OP_8xy0;
+		case 0x1: return &Chip8::OP_8xy1<Quirks>;
+		case 0x2: return &Chip8::OP_8xy2<Quirks>;
+		case 0x3: return &Chip8::OP_8xy3<Quirks>;
+		case 0x4: return &Chip8::OP_8xy4;
+		case 0x5: return &Chip8::OP_8xy5;
+		case 0x6: return &Chip8::OP_8xy6<Quirks>;
+		case 0x7: return &Chip8::OP_8xy7;
+		case 0xE: return &Chip8::OP_8xyE<Quirks>;
+		default: return &Chip8::OP_NULL;
+		}
+	case 0x9: return &Chip8::OP_9xy0;
+	case 0xA: return &Chip8::OP_Annn;
+	case 0xB: return &Chip8::OP_Bnnn<Quirks>;
+	case 0xC: return &Chip8::OP_Cxnn;
+	case 0xD: return &Chip8::OP_Dxyn<Quirks>;
+	case 0xE:
+		switch (opcode & 0x00FF)
+		{
+		case 0x9E: return &Chip8::OP_Ex9E;
+		case 0xA1: return &Chip8::OP_ExA1;
+		default: return &Chip8::OP_NULL;
+		}
+	case 0xF:
+		switch (opcode & 0x00FF)
+		{
+		case 0x07: return &Chip8::OP_Fx07;
+		case 0x0A: return &Chip8::OP_Fx0A;
+		case 0x15: return &Chip8::OP_Fx15;
+		case 0x18: return &Chip8::OP_Fx18;
+		case 0x1E: return &Chip8::OP_Fx1E;
+		case 0x29: return &Chip8::OP_Fx29;
+		case 0x33: return &Chip8::OP_Fx33;
+		case 0x55: return &Chip8::OP_Fx55<Quirks>;
+		case 0x65: return &Chip8::OP_Fx65<Quirks>;
+		default: return &Chip8::OP_NULL;
+		}
+	}
+
+	return &Chip8::OP_NULL;
+}
+#pragma endregion
+
+#pragma region Instruction Cache
+uint16_t Chip8::FetchOpcode(unsigned int address) const
+{
+	return (state.memory[address & (MEMORY_SIZE - 1)] << 8) | state.memory[(address + 1) & (MEMORY_SIZE - 1)];
+}
+
+void Chip8::InvalidateDecoded(unsigned int address, unsigned int count)
+{
+	if (jit)
+	{
+		jit->Invalidate(address, count);
+	}
+
+	// Self-modifying code is left to the interpreter
+	if (compiledROM)
+	{
+		for (unsigned int i = 0; i < count; ++i)
+		{
+			unsigned int written = (address + i) & (MEMORY_SIZE - 1);
+			if (compiledROM->codeMap[written / 8] & (1 << (written % 8)))
+			{
+				compiledROM = nullptr;
+				break;
+			}
+		}
+	}
+
+	// A slot reads up to MAX_FUSED_BYTES bytes, so the slots just before the write are affected too
+	for (unsigned int i = 0; i < count + MAX_FUSED_BYTES - 1; ++i)
+	{
+		DecodeSlot((address + MEMORY_SIZE - (MAX_FUSED_BYTES - 1) + i) & (MEMORY_SIZE - 1));
+	}
+}
+
+void Chip8::DecodeAll()
+{
+	if (jit)
+	{
+		jit->Flush();
+	}
+
+	for (unsigned int address = 0; address < MEMORY_SIZE; ++address)
+	{
+		DecodeSlot(address);
+	}
+}
+
+void Chip8::DecodeSlot(unsigned int address)
+{
+	const Instruction& first = opcodeTable[FetchOpcode(address)];
+	decoded[address] = first;
+
+	if (!fusionEnabled)
+	{
+		return;
+	}
+
+	uint16_t secondOpcode = FetchOpcode(address + 2);
+	const Instruction& second = opcodeTable[secondOpcode];
+
+	Chip8Func fused = nullptr;
+	uint8_t length = 2;
+	// Dxyn depends on the quirk profile, it is recognised through the selected table
+	if (first.handler == &Chip8::OP_Annn && second.handler == opcodeTable[0xD000].handler)
+	{
+		fused = &Chip8::OP_Annn_Dxyn;
+	}
+	else if (first.handler == &Chip8::OP_6xnn && second.handler == &Chip8::OP_6xnn)
+	{
+		fused = &Chip8::OP_6xnn_6xnn;
+	}
+	else if (first.handler == &Chip8::OP_7xnn && second.handler == &Chip8::OP_3xnn && first.x == second.x)
+	{
+		fused = &Chip8::OP_7xnn_3xnn;
+	}
+	else if (first.handler == &Chip8::OP_Fx07 && second.handler == &Chip8::OP_3xnn && first.x == second.x)
+	{
+		// Only fuse the loop form, where the jump goes back to the Fx07
+		const Instruction& third = opcodeTable[FetchOpcode(address + 4)];
+		if (third.handler == &Chip8::OP_1nnn && third.nnn == address)
+		{
+			fused = &Chip8::OP_Fx07_3xnn_1nnn;
+			length = 3;
+		}
+	}
+
+	if (fused)
+	{
+		decoded[address].handler = fused;
+		decoded[address].length = length;
+	}
+}
+#pragma endregion
+
+#pragma region Operation Codes
+void Chip8::OP_NULL(const Instruction&)
+{
+	// Execution goes on as if it were a no-operation code
+	RaiseFault(Fault::InvalidOpcode);
+}
+
+void Chip8::OP_00E0(const Instruction&)
+{
+	memset(state.video, 0, sizeof(state.video));
+}
+
+void Chip8::OP_00EE(const Instruction&)
+{
+	// Unbalanced calls and returns wrap around the stack instead of running over the machine state
+	if (state.sp == 0)
+	{
+		RaiseFault(Fault::StackUnderflow);
+	}
+	--state.sp;
+	state.pc = state.stack[state.sp & (STACK_LEVELS - 1)];
+
+#if CHIP8_PROFILER
+	if (callGraph)
+	{
+		callGraph->Return(state.cycles + 1);
+	}
+#endif
+}
+
+void Chip8::OP_1nnn(const Instruction& ins)
+{
+	if (ins.nnn + 2 == state.pc)
+	{
+		halt = Halt::SelfJump;
+	}
+	state.pc = ins.nnn;
+}
+
+void Chip8::OP_2nnn(const Instruction& ins)
+{
+	if (state.sp >= STACK_LEVELS)
+	{
+		RaiseFault(Fault::StackOverflow);
+	}
+	state.stack[state.sp & (STACK_LEVELS - 1)] = state.pc;
+	++state.sp;
+	state.pc = ins.nnn;
+
+#if CHIP8_PROFILER
+	if (callGraph)
+	{
+		callGraph->Call(ins.nnn, state.cycles + 1);
+	}
+#endif
+}
+
+void Chip8::OP_3xnn(const Instruction& ins)
+{
+	if (state.registers[ins.x] == ins.nn)
+	{
+		// Skip next instruction
+		state.pc += 2;
+	}
+}
+
+void Chip8::OP_4xnn(const Instruction& ins)
+{
+	if (state.registers[ins.x] != ins.nn)
+	{
+		// Skip next instruction
+		state.pc += 2;
+	}
+}
+
+void Chip8::OP_5xy0(const Instruction& ins)
+{
+	if (state.registers[ins.x] == state.registers[ins.y])
+	{
+		// Skip next instruction
+		state.pc += 2;
+	}
+}
+
+void Chip8::OP_6xnn(const Instruction& ins)
+{
+	state.registers[ins.x] = ins.nn;
+}
+
+void Chip8::OP_7xnn(const Instruction& ins)
+{
+	state.registers[ins.x] += ins.nn;
+}
+
+void Chip8::OP_8xy0(const Instruction& ins)
+{
+	state.registers[ins.x] = state.registers[ins.y];
+}
+
+template <Chip8Quirks Quirks>
+void Chip8::OP_8xy1(const Instruction& ins)
+{
+	state.registers[ins.x] |= state.registers[ins.y];
+
+	if constexpr (Quirks.logicResetsVF)
+	{
+		state.registers[0xF] = 0;
+	}
+}
+
+template <Chip8Quirks Quirks>
+void Chip8::OP_8xy2(const Instruction& ins)
+{
+	state.registers[ins.x] &= state.registers[ins.y];
+
+	if constexpr (Quirks.logicResetsVF)
+	{
+		state.registers[0xF] = 0;
+	}
+}
+
+template <Chip8Quirks Quirks>
+void Chip8::OP_8xy3(const Instruction& ins)
+{
+	state.registers[ins.x] ^= state.registers[ins.y];
+
+	if constexpr (Quirks.logicResetsVF)
+	{
+		state.registers[0xF] = 0;
+	}
+}
+
+void Chip8::OP_8xy4(const Instruction& ins)
+{
+	uint16_t sum = state.registers[ins.x] + state.registers[ins.y];
+
+	// Store the result in Vx
+	state.registers[ins.x] = sum & 0xFF;
+
+	// Set carry flag
+	state.registers[0xF] = (sum > 0xFF) ? 1 : 0;
+}
+
+void Chip8::OP_8xy5(const Instruction& ins)
+{
+	// Set carry flag
+	state.registers[0xF] = (state.registers[ins.x] > state.registers[ins.y]) ? 1 : 0;
+
+	// Subtract Vy from Vx
+	state.registers[ins.x] -= state.registers[ins.y];
+}
+
+template <Chip8Quirks Quirks>
+void Chip8::OP_8xy6(const Instruction& ins)
+{
+	uint8_t value = state.registers[Quirks.shiftUsesVy ? ins.y : ins.x];
+
+	// Set carry flag to the least significant bit
+	state.registers[0xF] = value & 0x01;
+
+	// Shift right by 1
+	state.registers[ins.x] = value >> 1;
+}
+
+void Chip8::OP_8xy7(const Instruction& ins)
+{
+	// Set carry flag
+	state.registers[0xF] = (state.registers[ins.y] > state.registers[ins.x]) ? 1 : 0;
+
+	// Subtract Vx from Vy
+	state.registers[ins.x] = state.registers[ins.y] - state.registers[ins.x];
+}
+
+template <Chip8Quirks Quirks>
+void Chip8::OP_8xyE(const Instruction& ins)
+{
+	uint8_t value = state.registers[Quirks.shiftUsesVy ? ins.y : ins.x];
+
+	// Set carry flag to the most significant bit
+	state.registers[0xF] = (value & 0x80) >> 7;
+
+	// Shift left by 1
+	state.registers[ins.x] = value << 1;
+}
+
+void Chip8::OP_9xy0(const Instruction& ins)
+{
+	if (state.registers[ins.x] != state.registers[ins.y])
+	{
+		// Skip next instruction
+		state.pc += 2;
+	}
+}
+
+void Chip8::OP_Annn(const Instruction& ins)
+{
+	state.index = ins.nnn;
+}
+
+template <Chip8Quirks Quirks>
+void Chip8::OP_Bnnn(const Instruction& ins)
+{
+	// xnn is nnn, only the register changes
+	state.pc = ins.nnn + state.registers[Quirks.jumpUsesVx ? ins.x : 0];
+}
+
+void Chip8::OP_Cxnn(const Instruction& ins)
+{
+	// Generate a random byte and mask it with nn
+	state.registers[ins.x] = NextRandomByte(state.randState) & ins.nn;
+}
+
+template <Chip8Quirks Quirks>
+void Chip8::OP_Dxyn(const Instruction& ins)
+{
+	// Draw a sprite at the position (Vx, Vy) with height n
+	uint8_t x = state.registers[ins.x] % VIDEO_WIDTH;
+	uint8_t y = state.registers[ins.y] % VIDEO_HEIGHT;
+
+	// Each sprite row is moved to column x and XORed into the display row, set bits on both sides collide
+	uint64_t collision = 0;
+	for (uint8_t row = 0; row < ins.n; ++row)
+	{
+		unsigned int line = y + row;
+		if constexpr (Quirks.spritesWrap)
+		{
+			line %= VIDEO_HEIGHT;
+		}
+		else if (line >= VIDEO_HEIGHT)
+		{
+			// Sprites are clipped at the bottom edge
+			break;
+		}
+
+		uint64_t sprite = static_cast<uint64_t>(state.memory[(state.index + row) & (MEMORY_SIZE - 1)]) << (VIDEO_WIDTH - 8);
+		// Columns past the right edge are shifted out, or rotated back in on the left when wrapping
+		sprite = Quirks.spritesWrap ? std::rotr(sprite, x) : sprite >> x;
+
+		collision |= state.video[line] & sprite;
+		state.video[line] ^= sprite;
+	}
+
+	state.registers[0xF] = collision != 0 ? 1 : 0;
+}
+
+void Chip8::OP_Ex9E(const Instruction& ins)
+{
+	// Check if the key corresponding to Vx is pressed
+	if (state.keypad[state.registers[ins.x] & 0xF] != 0)
+	{
+		// Skip next instruction
+		state.pc += 2;
+	}
+}
+void Chip8::OP_ExA1(const Instruction& ins)
+{
+	// Check if the key corresponding to Vx is not pressed
+	if (state.keypad[state.registers[ins.x] & 0xF] == 0)
+	{
+		// Skip next instruction
+		state.pc += 2;
+	}
+}
+
+void Chip8::OP_Fx07(const Instruction& ins)
+{
+	// Set Vx to the value of the delay timer
+	state.registers[ins.x] = state.delayTimer;
+}
+
+void Chip8::OP_Fx0A(const Instruction& ins)
+{
+	// Wait for a key press and store the value in Vx
+	bool keyPressed = false;
+	for (int i = 0; i < KEY_COUNT; ++i)
+	{
+		if (state.keypad[i] != 0)
+		{
+			state.registers[ins.x] = i;
+			keyPressed = true;
+			break;
+		}
+	}
+
+	if (!keyPressed)
+	{
+		// Repeat this instruction until a key is pressed
+		state.pc -= 2;
+		halt = Halt::KeyWait;
+	}
+}
+
+void Chip8::OP_Fx15(const Instruction& ins)
+{
+	// Set the delay timer to the value of Vx
+	state.delayTimer = state.registers[ins.x];
+}
+
+void Chip8::OP_Fx18(const Instruction& ins)
+{
+	// Set the sound timer to the value of Vx
+	state.soundTimer = state.registers[ins.x];
+}
+
+void Chip8::OP_Fx1E(const Instruction& ins)
+{
+	// Add Vx to I
+	state.index += state.registers[ins.x];
+}
+
+void Chip8::OP_Fx29(const Instruction& ins)
+{
+	// Set I to the address of the sprite for the character in Vx
+	// A font sprite is 5 bytes tall
+	state.index = FONTSET_START_ADDRESS + (state.registers[ins.x] * 5);
+}
+
+void Chip8::OP_Fx33(const Instruction& ins)
+{
+	// Store the binary-coded decimal representation of Vx in memory starting at I
+	state.memory[state.index & (MEMORY_SIZE - 1)] = state.registers[ins.x] / 100; // Hundreds
+	state.memory[(state.index + 1) & (MEMORY_SIZE - 1)] = (state.registers[ins.x] / 10) % 10; // Tens
+	state.memory[(state.index + 2) & (MEMORY_SIZE - 1)] = state.registers[ins.x] % 10; // Ones
+
+	// Keep the instruction cache coherent with self-modifying code
+	InvalidateDecoded(state.index, 3);
+}
+
+template <Chip8Quirks Quirks>
+void Chip8::OP_Fx55(const Instruction& ins)
+{
+	// The store may overwrite this very instruction, ins is re-decoded with it
+	const unsigned int count = ins.x + 1;
+
+	// Store the values of V0 to Vx in memory starting at I
+	for (unsigned int i = 0; i < count; ++i)
+	{
+		state.memory[(state.index + i) & (MEMORY_SIZE - 1)] = state.registers[i];
+	}
+
+	// Keep the instruction cache coherent with self-modifying code
+	InvalidateDecoded(state.index, count);
+
+	if constexpr (Quirks.loadStoreIncrementsIndex)
+	{
+		state.index += count;
+	}
+}
+
+template <Chip8Quirks Quirks>
+void Chip8::OP_Fx65(const Instruction& ins)
+{
+	// Load the values from memory starting at I into V0 to Vx
+	for (uint8_t i = 0; i <= ins.x; ++i)
+	{
+		state.registers[i] = state.memory[(state.index + i) & (MEMORY_SIZE - 1)];
+	}
+
+	if constexpr (Quirks.loadStoreIncrementsIndex)
+	{
+		state.index += ins.x + 1;
+	}
+}
+#pragma endregion
+
+#pragma region Superinstructions
+// Each fused handler runs its instructions through the regular handlers exactly like separate cycles would,
+// a fused sequence never crosses a timer tick. PC already points past the first instruction on entry.
+void Chip8::OP_Annn_Dxyn(const Instruction& ins)
+{
+	// A Dxyn slot is never fused, it holds the draw handler of the selected profile
+	const Instruction& draw = decoded[state.pc & (MEMORY_SIZE - 1)];
+
+	OP_Annn(ins);
+
+	state.pc += 2;
+	(this->*draw.handler)(draw);
+}
+
+void Chip8::OP_6xnn_6xnn(const Instruction& ins)
+{
+	const Instruction& load = decoded[state.pc & (MEMORY_SIZE - 1)];
+
+	OP_6xnn(ins);
+
+	state.pc += 2;
+	OP_6xnn(load);
+}
+
+void Chip8::OP_Fx07_3xnn_1nnn(const Instruction& ins)
+{
+	const Instruction& skip = decoded[state.pc & (MEMORY_SIZE - 1)];
+	const Instruction& jump = decoded[(state.pc + 2) & (MEMORY_SIZE - 1)];
+
+	OP_Fx07(ins);
+
+	state.pc += 2;
+	if (state.registers[ins.x] == skip.nn)
+	{
+		// The skip jumps over the 1nnn, only two instructions retire
+		state.pc += 2;
+		retired = 2;
+		return;
+	}
+
+	// Jump back to the Fx07
+	state.pc += 2;
+	OP_1nnn(jump);
+	halt = Halt::DelayPoll;
+}
+
+void Chip8::OP_7xnn_3xnn(const Instruction& ins)
+{
+	const Instruction& skip = decoded[state.pc & (MEMORY_SIZE - 1)];
+
+	OP_7xnn(ins);
+
+	state.pc += 2;
+	OP_3xnn(skip);
+}
+#pragma endregion
\ No newline at end of file
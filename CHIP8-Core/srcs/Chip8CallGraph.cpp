@@ -0,0 +1,177 @@
+#include "Chip8CallGraph.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+Chip8CallGraph::Chip8CallGraph(uint64_t cycles)
+{
+	Clear(cycles);
+}
+
+void Chip8CallGraph::Rebuild(const uint16_t* entries, unsigned int count, uint64_t cycles)
+{
+	depth = 0;
+	overflowCalls = 0;
+	lastCycles = cycles;
+	frames[0] = { 0, cycles };
+	for (unsigned int level = 0; level < std::min(count, Chip8::STACK_LEVELS); ++level)
+	{
+		Enter(entries[level], cycles);
+	}
+}
+
+void Chip8CallGraph::Clear(uint64_t cycles)
+{
+	// Keep the chain of the subroutines running, in a fresh tree
+	uint16_t entries[Chip8::STACK_LEVELS];
+	unsigned int count = depth;
+	for (unsigned int level = 0; level < count; ++level)
+	{
+		entries[level] = nodes[frames[level + 1].node].address;
+	}
+
+	nodes.clear();
+	nodes.push_back({ static_cast<uint16_t>(Chip8::START_ADDRESS), NO_NODE, NO_NODE, NO_NODE, 0, 0 });
+	memset(addressCalls, 0, sizeof(addressCalls));
+	memset(addressSelfCycles, 0, sizeof(addressSelfCycles));
+	memset(addressTotalCycles, 0, sizeof(addressTotalCycles));
+	Rebuild(entries, count, cycles);
+}
+
+void Chip8CallGraph::Enter(uint16_t address, uint64_t cycles)
+{
+	address &= Chip8::MEMORY_SIZE - 1;
+	uint32_t parent = frames[depth].node;
+	uint32_t child = nodes[parent].firstChild;
+	while (child != NO_NODE && nodes[child].address != address)
+	{
+		child = nodes[child].nextSibling;
+	}
+
+	if (child == NO_NODE)
+	{
+		if (nodes.size() < MAX_NODES)
+		{
+			child = static_cast<uint32_t>(nodes.size());
+			nodes.push_back({ address, parent, NO_NODE, nodes[parent].firstChild, 0, 0 });
+			nodes[parent].firstChild = child;
+		}
+		else
+		{
+			// Out of nodes, the subroutine is counted in its caller
+			child = parent;
+		}
+	}
+
+	frames[++depth] = { child, cycles };
+}
+
+void Chip8CallGraph::Leave(uint64_t cycles)
+{
+	uint16_t address = nodes[frames[depth].node].address;
+	if (!IsOnStackBelow(address, depth))
+	{
+		addressTotalCycles[address] += cycles - frames[depth].entryCycles;
+	}
+	--depth;
+}
+
+bool Chip8CallGraph::IsOnStackBelow(uint16_t address, unsigned int level) const
+{
+	for (unsigned int below = 1; below < level; ++below)
+	{
+		if (nodes[frames[below].node].address == address)
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+void Chip8CallGraph::Summarize(Summary& summary, uint64_t cycles) const
+{
+	// What ran since the last event belongs to the subroutine running
+	uint16_t running = nodes[frames[depth].node].address;
+	uint64_t elapsed = cycles > lastCycles ? cycles - lastCycles : 0;
+
+	summary.cycles = 0;
+	summary.subroutineCount = 0;
+	for (unsigned int address = 0; address < Chip8::MEMORY_SIZE; ++address)
+	{
+		uint64_t selfCycles = addressSelfCycles[address] + (address == running ? elapsed : 0);
+		summary.cycles += selfCycles;
+		if (selfCycles == 0)
+		{
+			continue;
+		}
+
+		// Busiest first, at most SUMMARY_SUBROUTINES of them
+		unsigned int position = summary.subroutineCount;
+		while (position > 0 && selfCycles > summary.subroutines[position - 1].selfCycles)
+		{
+			--position;
+		}
+		if (position >= SUMMARY_SUBROUTINES)
+		{
+			continue;
+		}
+		summary.subroutineCount = std::min(summary.subroutineCount + 1, SUMMARY_SUBROUTINES);
+		for (unsigned int i = summary.subroutineCount - 1; i > position; --i)
+		{
+			summary.subroutines[i] = summary.subroutines[i - 1];
+		}
+		summary.subroutines[position] = { static_cast<uint16_t>(address), addressCalls[address], selfCycles, addressTotalCycles[address] };
+	}
+
+	// Subroutines still running have not returned their time yet, the code outside any subroutine never does
+	for (unsigned int i = 0; i < summary.subroutineCount; ++i)
+	{
+		Subroutine& subroutine = summary.subroutines[i];
+		for (unsigned int level = 1; level <= depth; ++level)
+		{
+			if (nodes[frames[level].node].address == subroutine.address && !IsOnStackBelow(subroutine.address, level))
+			{
+				subroutine.totalCycles += cycles - frames[level].entryCycles;
+			}
+		}
+		if (subroutine.address == Chip8::START_ADDRESS && addressCalls[subroutine.address] == 0)
+		{
+			subroutine.totalCycles = summary.cycles;
+		}
+	}
+
+	summary.depth = depth;
+	summary.nodeCount = nodes.size();
+}
+
+void Chip8CallGraph::WriteFolded(std::ostream& out, const std::string& rootName, uint64_t cycles) const
+{
+	uint32_t running = frames[depth].node;
+	uint64_t elapsed = cycles > lastCycles ? cycles - lastCycles : 0;
+
+	char frame[8];
+	uint16_t chain[Chip8::STACK_LEVELS + 1];
+	for (uint32_t node = 0; node < nodes.size(); ++node)
+	{
+		uint64_t selfCycles = nodes[node].selfCycles + (node == running ? elapsed : 0);
+		if (selfCycles == 0)
+		{
+			continue;
+		}
+
+		// Innermost first, written outermost first
+		unsigned int length = 0;
+		for (uint32_t up = node; up != 0; up = nodes[up].parent)
+		{
+			chain[length++] = nodes[up].address;
+		}
+		out << rootName;
+		while (length > 0)
+		{
+			snprintf(frame, sizeof(frame), ";0x%03X", chain[--length]);
+			out << frame;
+		}
+		out << ' ' << selfCycles << '\n';
+	}
+}
\ No newline at end of file
@@ -0,0 +1,610 @@
+#include "Chip8JIT.h"
+
+#include <algorithm>
+#include <cstring>
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#endif
+
+#include "Chip8.h"
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define CHIP8_JIT_X64 1
+#else
+#define CHIP8_JIT_X64 0
+#endif
+
+namespace
+{
+	// x86 condition codes for Jcc rel32 (0F 8x)
+	constexpr uint8_t JUMP_ALWAYS = 0x00;
+	constexpr uint8_t JUMP_BELOW = 0x82;
+	constexpr uint8_t JUMP_ABOVE_OR_EQUAL = 0x83;
+	constexpr uint8_t JUMP_EQUAL = 0x84;
+	constexpr uint8_t JUMP_NOT_EQUAL = 0x85;
+
+	// SETcc al (0F 9x C0)
+	constexpr uint8_t SET_EQUAL = 0x94;
+	constexpr uint8_t SET_NOT_EQUAL = 0x95;
+
+	// ModRM reg field values
+	constexpr uint8_t REG_AL = 0;
+	constexpr uint8_t REG_CL = 1;
+
+	// Allocated writable, ProtectExecutable switches it to executable once code is emitted
+	uint8_t* AllocateExecutable(size_t size)
+	{
+#if !CHIP8_JIT_X64
+		(void)size;
+		return nullptr;
+#elif defined(_WIN32)
+		return static_cast<uint8_t*>(VirtualAlloc(nullptr, size, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE));
+#else
+		void* memory = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		return memory == MAP_FAILED ? nullptr : static_cast<uint8_t*>(memory);
+#endif
+	}
+
+	// Never writable and executable at the same time
+	bool ProtectExecutable(uint8_t* memory, size_t size, bool executable)
+	{
+#if defined(_WIN32)
+		DWORD previous;
+		return VirtualProtect(memory, size, executable ? PAGE_EXECUTE_READ : PAGE_READWRITE, &previous) != 0;
+#else
+		return mprotect(memory, size, executable ? PROT_READ | PROT_EXEC : PROT_READ | PROT_WRITE) == 0;
+#endif
+	}
+
+	void FreeExecutable(uint8_t* memory, size_t size)
+	{
+#if defined(_WIN32)
+		(void)size;
+		VirtualFree(memory, 0, MEM_RELEASE);
+#else
+		munmap(memory, size);
+#endif
+	}
+}
+
+Chip8JIT::Chip8JIT(Chip8& chip8)
+	: chip8(chip8), blocks(Chip8::MEMORY_SIZE, nullptr), untranslatable(Chip8::MEMORY_SIZE, false),
+	translatedBytes(Chip8::MEMORY_SIZE, false)
+{
+	// Generated code addresses the machine state relative to the instance held in rbx
+	auto offsetOf = [&chip8](const void* field)
+	{
+		return static_cast<int32_t>(static_cast<const uint8_t*>(field) - reinterpret_cast<const uint8_t*>(&chip8));
+	};
+	registersOffset = offsetOf(chip8.state.registers);
+	memoryOffset = offsetOf(chip8.state.memory);
+	indexOffset = offsetOf(&chip8.state.index);
+	pcOffset = offsetOf(&chip8.state.pc);
+	stackOffset = offsetOf(chip8.state.stack);
+	spOffset = offsetOf(&chip8.state.sp);
+	delayTimerOffset = offsetOf(&chip8.state.delayTimer);
+	soundTimerOffset = offsetOf(&chip8.state.soundTimer);
+	keypadOffset = offsetOf(chip8.state.keypad);
+
+	code = AllocateExecutable(CODE_SIZE);
+	if (!code)
+	{
+		return;
+	}
+
+	// Entry stub: save the callee-saved registers we use, load the instance and budget then jump to the block
+	enter = reinterpret_cast<EntryFunc>(code);
+	Emit8(0x53);                                // push rbx
+	Emit8(0x41); Emit8(0x54);                   // push r12
+#if defined(_WIN32)
+	Emit8(0x48); Emit8(0x89); Emit8(0xCB);      // mov rbx, rcx
+	Emit8(0x41); Emit8(0x89); Emit8(0xD4);      // mov r12d, edx
+	Emit8(0x41); Emit8(0xFF); Emit8(0xE0);      // jmp r8
+#else
+	Emit8(0x48); Emit8(0x89); Emit8(0xFB);      // mov rbx, rdi
+	Emit8(0x41); Emit8(0x89); Emit8(0xF4);      // mov r12d, esi
+	Emit8(0xFF); Emit8(0xE2);                   // jmp rdx
+#endif
+
+	// Exit stub: return the remaining budget
+	exitStub = code + codeUsed;
+	Emit8(0x44); Emit8(0x89); Emit8(0xE0);      // mov eax, r12d
+	Emit8(0x41); Emit8(0x5C);                   // pop r12
+	Emit8(0x5B);                                // pop rbx
+	Emit8(0xC3);                                // ret
+
+	stubsSize = codeUsed;
+
+	if (!SetWritable(false))
+	{
+		FreeExecutable(code, CODE_SIZE);
+		code = nullptr;
+	}
+}
+
+Chip8JIT::~Chip8JIT()
+{
+	if (code)
+	{
+		FreeExecutable(code, CODE_SIZE);
+	}
+}
+
+unsigned int Chip8JIT::Execute(unsigned int budget)
+{
+	if (!code)
+	{
+		return 0;
+	}
+
+	unsigned int remaining = budget;
+	while (remaining > 0 && chip8.state.pc < Chip8::MEMORY_SIZE)
+	{
+		uint8_t* block = blocks[chip8.state.pc];
+		if (!block)
+		{
+			if (untranslatable[chip8.state.pc] || !(block = Translate(chip8.state.pc)))
+			{
+				break;
+			}
+		}
+
+		// Blocks translated since the last call are emitted, the buffer goes back to executable before running them
+		if (!SetWritable(false))
+		{
+			break;
+		}
+		unsigned int left = enter(&chip8, remaining, block);
+		if (left == remaining)
+		{
+			// The next block does not fit in the budget, the interpreter finishes the slice
+			break;
+		}
+		remaining = left;
+	}
+
+	return budget - remaining;
+}
+
+void Chip8JIT::Invalidate(unsigned int address, unsigned int count)
+{
+	bool overlapsCode = false;
+	for (unsigned int i = 0; i < count; ++i)
+	{
+		unsigned int written = (address + i) & (Chip8::MEMORY_SIZE - 1);
+		overlapsCode = overlapsCode || translatedBytes[written];
+
+		// The new bytes may now form a translatable instruction
+		untranslatable[written] = false;
+		untranslatable[(written + Chip8::MEMORY_SIZE - 1) & (Chip8::MEMORY_SIZE - 1)] = false;
+	}
+
+	// Blocks are chained to each other, so dropping everything is the only safe option
+	if (overlapsCode)
+	{
+		Flush();
+	}
+}
+
+void Chip8JIT::Flush()
+{
+	codeUsed = stubsSize;
+	std::fill(blocks.begin(), blocks.end(), nullptr);
+	std::fill(untranslatable.begin(), untranslatable.end(), false);
+	std::fill(translatedBytes.begin(), translatedBytes.end(), false);
+	pendingLinks.clear();
+}
+
+uint8_t* Chip8JIT::Translate(unsigned int address)
+{
+#if CHIP8_JIT_X64
+	if (!SetWritable(true))
+	{
+		return nullptr;
+	}
+	if (CODE_SIZE - codeUsed < BLOCK_RESERVE)
+	{
+		Flush();
+	}
+
+	const size_t start = codeUsed;
+
+	// Bail out before executing anything when the budget cannot hold the whole block
+	Emit8(0x41); Emit8(0x81); Emit8(0xFC);      // cmp r12d, imm32
+	const size_t countPosition = codeUsed;
+	Emit32(0);
+	const size_t bailJump = EmitJump(JUMP_BELOW, nullptr);
+
+	// Exits taken before an instruction runs, when it would overflow or underflow the stack
+	struct SideExit
+	{
+		size_t position;
+		unsigned int retired;
+		unsigned int address;
+	};
+	std::vector<SideExit> sideExits;
+
+	const int32_t VF = registersOffset + 0xF;
+
+	// Quirk dependent handlers are instantiated per profile, they are recognised through the selected table
+	// and translated for that profile only
+	const Chip8Quirks& quirks = GetQuirks(chip8.quirkProfile);
+	const Chip8::Chip8Func OP_8xy1 = chip8.opcodeTable[0x8001].handler;
+	const Chip8::Chip8Func OP_8xy2 = chip8.opcodeTable[0x8002].handler;
+	const Chip8::Chip8Func OP_8xy3 = chip8.opcodeTable[0x8003].handler;
+	const Chip8::Chip8Func OP_8xy6 = chip8.opcodeTable[0x8006].handler;
+	const Chip8::Chip8Func OP_8xyE = chip8.opcodeTable[0x800E].handler;
+	const Chip8::Chip8Func OP_Bnnn = chip8.opcodeTable[0xB000].handler;
+	const Chip8::Chip8Func OP_Fx65 = chip8.opcodeTable[0xF065].handler;
+
+	unsigned int count = 0;
+	unsigned int current = address;
+	bool ended = false;
+
+	while (!ended && count < MAX_BLOCK_INSTRUCTIONS && current + 1 < Chip8::MEMORY_SIZE)
+	{
+		const Chip8::Instruction& ins = chip8.opcodeTable[chip8.FetchOpcode(current)];
+		const Chip8::Chip8Func handler = ins.handler;
+		const int32_t Vx = registersOffset + ins.x;
+		const int32_t Vy = registersOffset + ins.y;
+
+		// Idle loops are left to the interpreter, which fast-forwards through them
+		if ((handler == &Chip8::OP_1nnn && ins.nnn == current) || chip8.decoded[current].handler == &Chip8::OP_Fx07_3xnn_1nnn)
+		{
+			break;
+		}
+
+		// Skip instructions leave their condition in al
+		bool isSkip = true;
+		if (handler == &Chip8::OP_3xnn || handler == &Chip8::OP_4xnn)
+		{
+			EmitMem({ 0x80 }, 7, Vx); Emit8(ins.nn);                 // cmp byte [Vx], nn
+			Emit8(0x0F); Emit8(handler == &Chip8::OP_3xnn ? SET_EQUAL : SET_NOT_EQUAL); Emit8(0xC0);
+		}
+		else if (handler == &Chip8::OP_5xy0 || handler == &Chip8::OP_9xy0)
+		{
+			EmitMem({ 0x8A }, REG_AL, Vx);                           // mov al, [Vx]
+			EmitMem({ 0x3A }, REG_AL, Vy);                           // cmp al, [Vy]
+			Emit8(0x0F); Emit8(handler == &Chip8::OP_5xy0 ? SET_EQUAL : SET_NOT_EQUAL); Emit8(0xC0);
+		}
+		else if (handler == &Chip8::OP_Ex9E || handler == &Chip8::OP_ExA1)
+		{
+			EmitMem({ 0x0F, 0xB6 }, REG_AL, Vx);                     // movzx eax, byte [Vx]
+			Emit8(0x83); Emit8(0xE0); Emit8(0x0F);                   // and eax, 0xF
+			Emit8(0x80); Emit8(0xBC); Emit8(0x03); Emit32(keypadOffset); Emit8(0x00); // cmp byte [rbx + rax + keypad], 0
+			Emit8(0x0F); Emit8(handler == &Chip8::OP_Ex9E ? SET_NOT_EQUAL : SET_EQUAL); Emit8(0xC0);
+		}
+		else
+		{
+			isSkip = false;
+		}
+
+		if (isSkip)
+		{
+			++count;
+			Emit8(0x84); Emit8(0xC0);                                // test al, al
+			size_t skipJump = EmitJump(JUMP_NOT_EQUAL, nullptr);
+			EmitExit(count, current + 2);
+			PatchJump(skipJump, code + codeUsed);
+			EmitExit(count, current + 4);
+			ended = true;
+		}
+		else if (handler == &Chip8::OP_1nnn)
+		{
+			++count;
+			EmitExit(count, ins.nnn);
+			ended = true;
+		}
+		else if (handler == &Chip8::OP_2nnn)
+		{
+			EmitMem({ 0x80 }, 7, spOffset); Emit8(static_cast<uint8_t>(Chip8::STACK_LEVELS)); // cmp byte [sp], STACK_LEVELS
+			sideExits.push_back({ EmitJump(JUMP_ABOVE_OR_EQUAL, nullptr), count, current });
+			EmitMem({ 0x0F, 0xB6 }, REG_AL, spOffset);                // movzx eax, byte [sp]
+			Emit8(0x66); Emit8(0xC7); Emit8(0x84); Emit8(0x43); Emit32(stackOffset); Emit16(static_cast<uint16_t>(current + 2)); // mov word [rbx + rax * 2 + stack], return address
+			EmitMem({ 0xFE }, 0, spOffset);                           // inc byte [sp]
+			++count;
+			EmitExit(count, ins.nnn);
+			ended = true;
+		}
+		else if (handler == &Chip8::OP_00EE)
+		{
+			EmitMem({ 0x0F, 0xB6 }, REG_AL, spOffset);                // movzx eax, byte [sp]
+			Emit8(0x83); Emit8(0xE8); Emit8(0x01);                    // sub eax, 1
+			Emit8(0x83); Emit8(0xF8); Emit8(static_cast<uint8_t>(Chip8::STACK_LEVELS)); // cmp eax, STACK_LEVELS
+			sideExits.push_back({ EmitJump(JUMP_ABOVE_OR_EQUAL, nullptr), count, current });
+			EmitMem({ 0x88 }, REG_AL, spOffset);                      // mov [sp], al
+			Emit8(0x0F); Emit8(0xB7); Emit8(0x84); Emit8(0x43); Emit32(stackOffset); // movzx eax, word [rbx + rax * 2 + stack]
+			EmitMem({ 0x66, 0x89 }, REG_AL, pcOffset);                // mov [pc], ax
+			++count;
+			EmitDynamicExit(count);
+			ended = true;
+		}
+		else if (handler == OP_Bnnn)
+		{
+			EmitMem({ 0x0F, 0xB6 }, REG_AL, quirks.jumpUsesVx ? Vx : registersOffset); // movzx eax, byte [V0 or Vx]
+			Emit8(0x05); Emit32(ins.nnn);                             // add eax, nnn
+			EmitMem({ 0x66, 0x89 }, REG_AL, pcOffset);                // mov [pc], ax
+			++count;
+			EmitDynamicExit(count);
+			ended = true;
+		}
+		else
+		{
+			// Straight-line instructions
+			if (handler == &Chip8::OP_6xnn)
+			{
+				EmitMem({ 0xC6 }, 0, Vx); Emit8(ins.nn);             // mov byte [Vx], nn
+			}
+			else if (handler == &Chip8::OP_7xnn)
+			{
+				EmitMem({ 0x80 }, 0, Vx); Emit8(ins.nn);             // add byte [Vx], nn
+			}
+			else if (handler == &Chip8::OP_8xy0)
+			{
+				EmitMem({ 0x8A }, REG_AL, Vy);                       // mov al, [Vy]
+				EmitMem({ 0x88 }, REG_AL, Vx);                       // mov [Vx], al
+			}
+			else if (handler == OP_8xy1 || handler == OP_8xy2 || handler == OP_8xy3)
+			{
+				uint8_t operation = handler == OP_8xy1 ? 0x08 : handler == OP_8xy2 ? 0x20 : 0x30;
+				EmitMem({ 0x8A }, REG_AL, Vy);                       // mov al, [Vy]
+				EmitMem({ operation }, REG_AL, Vx);                  // or/and/xor [Vx], al
+				if (quirks.logicResetsVF)
+				{
+					EmitMem({ 0xC6 }, 0, VF); Emit8(0);              // mov byte [VF], 0
+				}
+			}
+			else if (handler == &Chip8::OP_8xy4)
+			{
+				EmitMem({ 0x8A }, REG_AL, Vx);                       // mov al, [Vx]
+				EmitMem({ 0x02 }, REG_AL, Vy);                       // add al, [Vy]
+				Emit8(0x0F); Emit8(0x92); Emit8(0xC1);               // setc cl
+				EmitMem({ 0x88 }, REG_AL, Vx);                       // mov [Vx], al
+				EmitMem({ 0x88 }, REG_CL, VF);                       // mov [VF], cl
+			}
+			else if (handler == &Chip8::OP_8xy5 || handler == &Chip8::OP_8xy7)
+			{
+				// Flag first, then the subtraction reloads its operands like the interpreter does
+				int32_t minuend = handler == &Chip8::OP_8xy5 ? Vx : Vy;
+				int32_t subtrahend = handler == &Chip8::OP_8xy5 ? Vy : Vx;
+				EmitMem({ 0x8A }, REG_AL, minuend);                  // mov al, [minuend]
+				EmitMem({ 0x3A }, REG_AL, subtrahend);               // cmp al, [subtrahend]
+				Emit8(0x0F); Emit8(0x97); Emit8(0xC1);               // seta cl
+				EmitMem({ 0x88 }, REG_CL, VF);                       // mov [VF], cl
+				EmitMem({ 0x8A }, REG_AL, minuend);                  // mov al, [minuend]
+				EmitMem({ 0x2A }, REG_AL, subtrahend);               // sub al, [subtrahend]
+				EmitMem({ 0x88 }, REG_AL, Vx);                       // mov [Vx], al
+			}
+			else if (handler == OP_8xy6)
+			{
+				EmitMem({ 0x8A }, REG_AL, quirks.shiftUsesVy ? Vy : Vx); // mov al, [Vx or Vy]
+				Emit8(0x88); Emit8(0xC1);                            // mov cl, al
+				Emit8(0x80); Emit8(0xE1); Emit8(0x01);               // and cl, 1
+				EmitMem({ 0x88 }, REG_CL, VF);                       // mov [VF], cl
+				Emit8(0xD0); Emit8(0xE8);                            // shr al, 1
+				EmitMem({ 0x88 }, REG_AL, Vx);                       // mov [Vx], al
+			}
+			else if (handler == OP_8xyE)
+			{
+				EmitMem({ 0x8A }, REG_AL, quirks.shiftUsesVy ? Vy : Vx); // mov al, [Vx or Vy]
+				Emit8(0x88); Emit8(0xC1);                            // mov cl, al
+				Emit8(0xC0); Emit8(0xE9); Emit8(0x07);               // shr cl, 7
+				EmitMem({ 0x88 }, REG_CL, VF);                       // mov [VF], cl
+				Emit8(0xD0); Emit8(0xE0);                            // shl al, 1
+				EmitMem({ 0x88 }, REG_AL, Vx);                       // mov [Vx], al
+			}
+			else if (handler == &Chip8::OP_Annn)
+			{
+				EmitMem({ 0x66, 0xC7 }, 0, indexOffset); Emit16(ins.nnn); // mov word [I], nnn
+			}
+			else if (handler == &Chip8::OP_Fx07)
+			{
+				EmitMem({ 0x8A }, REG_AL, delayTimerOffset);         // mov al, [delayTimer]
+				EmitMem({ 0x88 }, REG_AL, Vx);                       // mov [Vx], al
+			}
+			else if (handler == &Chip8::OP_Fx15 || handler == &Chip8::OP_Fx18)
+			{
+				EmitMem({ 0x8A }, REG_AL, Vx);                       // mov al, [Vx]
+				EmitMem({ 0x88 }, REG_AL, handler == &Chip8::OP_Fx15 ? delayTimerOffset : soundTimerOffset);
+			}
+			else if (handler == &Chip8::OP_Fx1E)
+			{
+				EmitMem({ 0x0F, 0xB6 }, REG_AL, Vx);                 // movzx eax, byte [Vx]
+				EmitMem({ 0x66, 0x01 }, REG_AL, indexOffset);        // add word [I], ax
+			}
+			else if (handler == &Chip8::OP_Fx29)
+			{
+				EmitMem({ 0x0F, 0xB6 }, REG_AL, Vx);                 // movzx eax, byte [Vx]
+				Emit8(0x8D); Emit8(0x84); Emit8(0x80); Emit32(Chip8::FONTSET_START_ADDRESS); // lea eax, [rax + rax * 4 + font]
+				EmitMem({ 0x66, 0x89 }, REG_AL, indexOffset);        // mov [I], ax
+			}
+			else if (handler == OP_Fx65)
+			{
+				for (unsigned int i = 0; i <= ins.x; ++i)
+				{
+					EmitMem({ 0x0F, 0xB7 }, REG_AL, indexOffset);    // movzx eax, word [I]
+					Emit8(0x05); Emit32(i);                          // add eax, i
+					Emit8(0x25); Emit32(Chip8::MEMORY_SIZE - 1);     // and eax, MEMORY_SIZE - 1
+					Emit8(0x8A); Emit8(0x8C); Emit8(0x03); Emit32(memoryOffset); // mov cl, [rbx + rax + memory]
+					EmitMem({ 0x88 }, REG_CL, registersOffset + static_cast<int32_t>(i)); // mov [Vi], cl
+				}
+				if (quirks.loadStoreIncrementsIndex)
+				{
+					EmitMem({ 0x66, 0x83 }, 0, indexOffset); Emit8(ins.x + 1); // add word [I], x + 1
+				}
+			}
+			else
+			{
+				// Drawing, key waits, memory writes, RNG and invalid opcodes are left to the interpreter
+				break;
+			}
+
+			++count;
+		}
+
+		translatedBytes[current] = true;
+		translatedBytes[current + 1] = true;
+		current += 2;
+	}
+
+	if (count == 0)
+	{
+		codeUsed = start;
+		untranslatable[address] = true;
+		return nullptr;
+	}
+
+	if (!ended)
+	{
+		EmitExit(count, current);
+	}
+
+	// Not enough budget: PC stays on the block
+	PatchJump(bailJump, code + codeUsed);
+	EmitMem({ 0x66, 0xC7 }, 0, pcOffset); Emit16(static_cast<uint16_t>(address));
+	EmitJump(JUMP_ALWAYS, exitStub);
+
+	// Side exits always return so the interpreter executes the faulting instruction
+	for (const SideExit& sideExit : sideExits)
+	{
+		PatchJump(sideExit.position, code + codeUsed);
+		if (sideExit.retired > 0)
+		{
+			Emit8(0x41); Emit8(0x81); Emit8(0xEC); Emit32(sideExit.retired); // sub r12d, retired
+		}
+		EmitMem({ 0x66, 0xC7 }, 0, pcOffset); Emit16(static_cast<uint16_t>(sideExit.address));
+		EmitJump(JUMP_ALWAYS, exitStub);
+	}
+
+	std::memcpy(code + countPosition, &count, sizeof(uint32_t));
+
+	uint8_t* block = code + start;
+	blocks[address] = block;
+	LinkPending(address, block);
+	return block;
+#else
+	untranslatable[address] = true;
+	return nullptr;
+#endif
+}
+
+bool Chip8JIT::SetWritable(bool enabled)
+{
+	if (writable != enabled)
+	{
+		if (!ProtectExecutable(code, CODE_SIZE, !enabled))
+		{
+			return false;
+		}
+		writable = enabled;
+	}
+	return true;
+}
+
+void Chip8JIT::LinkPending(unsigned int address, uint8_t* block)
+{
+	auto linked = std::remove_if(pendingLinks.begin(), pendingLinks.end(), [&](const PendingLink& link)
+		{
+			if (link.target != address)
+			{
+				return false;
+			}
+			PatchJump(link.position, block);
+			return true;
+		});
+	pendingLinks.erase(linked, pendingLinks.end());
+}
+
+#pragma region Emitter
+void Chip8JIT::Emit8(uint8_t value)
+{
+	code[codeUsed++] = value;
+}
+
+void Chip8JIT::Emit16(uint16_t value)
+{
+	std::memcpy(code + codeUsed, &value, sizeof(value));
+	codeUsed += sizeof(value);
+}
+
+void Chip8JIT::Emit32(uint32_t value)
+{
+	std::memcpy(code + codeUsed, &value, sizeof(value));
+	codeUsed += sizeof(value);
+}
+
+void Chip8JIT::EmitMem(std::initializer_list<uint8_t> opcode, uint8_t reg, int32_t displacement)
+{
+	for (uint8_t byte : opcode)
+	{
+		Emit8(byte);
+	}
+	// mod = 10 (disp32), rm = 011 (rbx)
+	Emit8(0x80 | (reg << 3) | 0x03);
+	Emit32(static_cast<uint32_t>(displacement));
+}
+
+size_t Chip8JIT::EmitJump(uint8_t condition, const uint8_t* target)
+{
+	if (condition == JUMP_ALWAYS)
+	{
+		Emit8(0xE9);
+	}
+	else
+	{
+		Emit8(0x0F);
+		Emit8(condition);
+	}
+
+	size_t position = codeUsed;
+	Emit32(0);
+	if (target)
+	{
+		PatchJump(position, target);
+	}
+	return position;
+}
+
+void Chip8JIT::PatchJump(size_t position, const uint8_t* target)
+{
+	int32_t relative = static_cast<int32_t>(target - (code + position + sizeof(int32_t)));
+	std::memcpy(code + position, &relative, sizeof(relative));
+}
+
+void Chip8JIT::EmitExit(unsigned int retired, unsigned int target)
+{
+	if (retired > 0)
+	{
+		Emit8(0x41); Emit8(0x81); Emit8(0xEC); Emit32(retired);        // sub r12d, retired
+	}
+
+	// Chain straight into the target when it is already translated
+	if (target < Chip8::MEMORY_SIZE && blocks[target])
+	{
+		EmitJump(JUMP_ALWAYS, blocks[target]);
+		return;
+	}
+
+	// Otherwise jump to the exit path right below, patched once the target gets translated
+	size_t link = EmitJump(JUMP_ALWAYS, nullptr);
+	PatchJump(link, code + codeUsed);
+	if (target < Chip8::MEMORY_SIZE)
+	{
+		pendingLinks.push_back({ link, target });
+	}
+
+	EmitMem({ 0x66, 0xC7 }, 0, pcOffset); Emit16(static_cast<uint16_t>(target)); // mov word [pc], target
+	EmitJump(JUMP_ALWAYS, exitStub);
+}
+
+void Chip8JIT::EmitDynamicExit(unsigned int retired)
+{
+	Emit8(0x41); Emit8(0x81); Emit8(0xEC); Emit32(retired);            // sub r12d, retired
+	EmitJump(JUMP_ALWAYS, exitStub);
+}
+#pragma endregion
\ No newline at end of file
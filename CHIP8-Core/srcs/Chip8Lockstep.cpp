@@ -0,0 +1,837 @@
+#include "Chip8Lockstep.h"
+
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define CHIP8_LOCKSTEP_AVX2 1
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#else
+#define CHIP8_LOCKSTEP_AVX2 0
+#endif
+
+// GCC and Clang only emit AVX2 instructions in functions built for that target, MSVC always can
+#if CHIP8_LOCKSTEP_AVX2 && !defined(_MSC_VER)
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define TARGET_AVX2
+#endif
+
+namespace
+{
+	bool HostSupportsAVX2()
+	{
+#if !CHIP8_LOCKSTEP_AVX2
+		return false;
+#elif defined(_MSC_VER)
+		int info[4];
+		__cpuid(info, 1);
+		// The OS must save the YMM registers on context switches
+		if ((info[2] & (1 << 27)) == 0 || (_xgetbv(0) & 6) != 6)
+		{
+			return false;
+		}
+		__cpuidex(info, 7, 0);
+		return (info[1] & (1 << 5)) != 0;
+#else
+		return __builtin_cpu_supports("avx2");
+#endif
+	}
+}
+
+Chip8Lockstep::Chip8Lockstep(unsigned int instanceCount, QuirkProfile profile)
+	: instanceCount(std::min(instanceCount, MAX_INSTANCES)), quirks(GetQuirks(profile))
+{
+	laneCount = (this->instanceCount + BLOCK_LANES - 1) / BLOCK_LANES * BLOCK_LANES;
+
+	registers.resize(Chip8::REGISTER_COUNT * laneCount);
+	memory.resize(Chip8::MEMORY_SIZE * laneCount + sizeof(uint32_t));
+	index.resize(laneCount);
+	pc.resize(laneCount);
+	stack.resize(Chip8::STACK_LEVELS * laneCount);
+	sp.resize(laneCount);
+	delayTimer.resize(laneCount);
+	soundTimer.resize(laneCount);
+	keypad.resize(laneCount * Chip8::KEY_COUNT);
+	video.resize(laneCount * Chip8::VIDEO_HEIGHT);
+	opcodes.resize(laneCount);
+	randStates.resize(laneCount);
+
+	for (unsigned int lane = 0; lane < laneCount; ++lane)
+	{
+		randStates[lane] = Chip8::SeedRandom(lane);
+		ResetLane(lane, {});
+	}
+
+	simdEnabled = HostSupportsAVX2();
+}
+
+bool Chip8Lockstep::LoadROM(const std::string& filename)
+{
+	std::ifstream file(filename, std::ios::binary);
+	if (!file)
+	{
+		std::cerr << "Failed to load ROM: " << filename << std::endl;
+		return false;
+	}
+
+	std::vector<uint8_t> rom((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+	if (Chip8::START_ADDRESS + rom.size() > Chip8::MEMORY_SIZE)
+	{
+		std::cerr << "ROM size exceeds memory limit." << std::endl;
+		return false;
+	}
+
+	for (unsigned int lane = 0; lane < laneCount; ++lane)
+	{
+		ResetLane(lane, rom);
+	}
+	groupCount = 0;
+	stepsToTick = tickCycles;
+
+	return true;
+}
+
+void Chip8Lockstep::ResetLane(unsigned int lane, const std::vector<uint8_t>& rom)
+{
+	for (unsigned int address = 0; address < Chip8::MEMORY_SIZE; ++address)
+	{
+		memory[address * laneCount + lane] = 0;
+	}
+	for (unsigned int i = 0; i < Chip8::FONTSET_SIZE; ++i)
+	{
+		memory[(Chip8::FONTSET_START_ADDRESS + i) * laneCount + lane] = Chip8::fontset[i];
+	}
+	for (size_t i = 0; i < rom.size(); ++i)
+	{
+		memory[(Chip8::START_ADDRESS + i) * laneCount + lane] = rom[i];
+	}
+
+	for (unsigned int reg = 0; reg < Chip8::REGISTER_COUNT; ++reg)
+	{
+		registers[reg * laneCount + lane] = 0;
+	}
+	for (unsigned int level = 0; level < Chip8::STACK_LEVELS; ++level)
+	{
+		stack[level * laneCount + lane] = 0;
+	}
+
+	index[lane] = 0;
+	pc[lane] = Chip8::START_ADDRESS;
+	sp[lane] = 0;
+	delayTimer[lane] = 0;
+	soundTimer[lane] = 0;
+	memset(&keypad[lane * Chip8::KEY_COUNT], 0, Chip8::KEY_COUNT);
+	memset(&video[lane * Chip8::VIDEO_HEIGHT], 0, Chip8::VIDEO_HEIGHT * sizeof(uint64_t));
+}
+
+bool Chip8Lockstep::SetSIMDEnabled(bool enabled)
+{
+	if (enabled && !HostSupportsAVX2())
+	{
+		simdEnabled = false;
+		return false;
+	}
+
+	simdEnabled = enabled;
+	return true;
+}
+
+const Chip8Recompiled::Operation* Chip8Lockstep::GetOperationTable()
+{
+	static const std::vector<Operation> table = []()
+	{
+		std::vector<Operation> operations(0xFFFF + 1);
+		for (uint32_t opcode = 0; opcode <= 0xFFFF; ++opcode)
+		{
+			operations[opcode] = Chip8Recompiled::GetOperation(static_cast<uint16_t>(opcode));
+		}
+		return operations;
+	}();
+
+	return table.data();
+}
+
+void Chip8Lockstep::Step()
+{
+	bool tick = --stepsToTick == 0;
+	if (tick)
+	{
+		stepsToTick = tickCycles;
+	}
+
+	const Operation* operations = GetOperationTable();
+	for (unsigned int base = 0; base < laneCount; base += BLOCK_LANES)
+	{
+		StepBlock(base, operations, tick);
+	}
+}
+
+void Chip8Lockstep::Run(uint64_t steps)
+{
+	// Lanes never interact, so the order in which blocks take their steps does not matter
+	const Operation* operations = GetOperationTable();
+	unsigned int blockStepsToTick = stepsToTick;
+	for (unsigned int base = 0; base < laneCount; base += BLOCK_LANES)
+	{
+		// Each block replays the same tick schedule from the current countdown
+		blockStepsToTick = stepsToTick;
+		for (uint64_t i = 0; i < steps; ++i)
+		{
+			bool tick = --blockStepsToTick == 0;
+			if (tick)
+			{
+				blockStepsToTick = tickCycles;
+			}
+			StepBlock(base, operations, tick);
+		}
+	}
+	stepsToTick = blockStepsToTick;
+}
+
+void Chip8Lockstep::SetTickCycles(unsigned int cycles)
+{
+	tickCycles = std::max(cycles, 1U);
+	stepsToTick = tickCycles;
+}
+
+void Chip8Lockstep::StepBlock(unsigned int base, const Operation* operations, bool tick)
+{
+	if (simdEnabled)
+	{
+		FetchBlockAVX2(base);
+	}
+	else
+	{
+		FetchBlock(base);
+	}
+
+	// Take the opcode of the first pending lane and run every lane sharing it, until no lane is left
+	uint32_t pending = UINT32_MAX;
+	while (pending != 0)
+	{
+		uint16_t opcode = opcodes[base + std::countr_zero(pending)];
+		uint32_t mask = (simdEnabled ? MatchOpcodeAVX2(base, opcode) : MatchOpcode(base, opcode)) & pending;
+		pending &= ~mask;
+
+		Group group = { operations[opcode], static_cast<uint16_t>(opcode & 0x0FFF), static_cast<uint8_t>((opcode & 0x0F00) >> 8),
+			static_cast<uint8_t>((opcode & 0x00F0) >> 4), static_cast<uint8_t>(opcode & 0x000F), static_cast<uint8_t>(opcode & 0x00FF) };
+		if (!simdEnabled || !ExecuteGroupAVX2(base, mask, group))
+		{
+			ExecuteGroup(base, mask, group);
+		}
+		++groupCount;
+	}
+
+	if (!tick)
+	{
+		return;
+	}
+
+	if (simdEnabled)
+	{
+		TickTimersAVX2(base);
+	}
+	else
+	{
+		TickTimers(base);
+	}
+}
+
+#pragma region Scalar
+void Chip8Lockstep::FetchBlock(unsigned int base)
+{
+	for (unsigned int lane = base; lane < base + BLOCK_LANES; ++lane)
+	{
+		opcodes[lane] = (memory[(pc[lane] & (Chip8::MEMORY_SIZE - 1)) * laneCount + lane] << 8)
+			| memory[((pc[lane] + 1) & (Chip8::MEMORY_SIZE - 1)) * laneCount + lane];
+	}
+}
+
+uint32_t Chip8Lockstep::MatchOpcode(unsigned int base, uint16_t opcode) const
+{
+	uint32_t mask = 0;
+	for (unsigned int i = 0; i < BLOCK_LANES; ++i)
+	{
+		mask |= static_cast<uint32_t>(opcodes[base + i] == opcode) << i;
+	}
+	return mask;
+}
+
+void Chip8Lockstep::ExecuteGroup(unsigned int base, uint32_t mask, const Group& group)
+{
+	for (uint32_t bits = mask; bits != 0; bits &= bits - 1)
+	{
+		ExecuteLane(base + std::countr_zero(bits), group);
+	}
+}
+
+void Chip8Lockstep::ExecuteLane(unsigned int lane, const Group& group)
+{
+	// Same semantics as the Chip8 handlers, see Chip8.cpp
+	auto V = [&](unsigned int reg) -> uint8_t& { return registers[reg * laneCount + lane]; };
+	auto Memory = [&](unsigned int address) -> uint8_t& { return memory[(address & (Chip8::MEMORY_SIZE - 1)) * laneCount + lane]; };
+	uint8_t& Vx = V(group.x);
+	uint8_t& Vy = V(group.y);
+	uint8_t& VF = V(0xF);
+	uint16_t& PC = pc[lane];
+	uint16_t& I = index[lane];
+
+	PC += 2;
+
+	switch (group.operation)
+	{
+	case Operation::OP_NULL:
+		break;
+	case Operation::OP_00E0:
+		memset(&video[lane * Chip8::VIDEO_HEIGHT], 0, Chip8::VIDEO_HEIGHT * sizeof(uint64_t));
+		break;
+	case Operation::OP_00EE:
+		--sp[lane];
+		PC = stack[(sp[lane] & (Chip8::STACK_LEVELS - 1)) * laneCount + lane];
+		break;
+	case Operation::OP_1nnn:
+		PC = group.nnn;
+		break;
+	case Operation::OP_2nnn:
+		stack[(sp[lane] & (Chip8::STACK_LEVELS - 1)) * laneCount + lane] = PC;
+		++sp[lane];
+		PC = group.nnn;
+		break;
+	case Operation::OP_3xnn:
+		PC += Vx == group.nn ? 2 : 0;
+		break;
+	case Operation::OP_4xnn:
+		PC += Vx != group.nn ? 2 : 0;
+		break;
+	case Operation::OP_5xy0:
+		PC += Vx == Vy ? 2 : 0;
+		break;
+	case Operation::OP_6xnn:
+		Vx = group.nn;
+		break;
+	case Operation::OP_7xnn:
+		Vx += group.nn;
+		break;
+	case Operation::OP_8xy0:
+		Vx = Vy;
+		break;
+	case Operation::OP_8xy1:
+	case Operation::OP_8xy2:
+	case Operation::OP_8xy3:
+		Vx = group.operation == Operation::OP_8xy1 ? Vx | Vy : group.operation == Operation::OP_8xy2 ? Vx & Vy : Vx ^ Vy;
+		if (quirks.logicResetsVF)
+		{
+			VF = 0;
+		}
+		break;
+	case Operation::OP_8xy4:
+	{
+		uint16_t sum = Vx + Vy;
+		Vx = sum & 0xFF;
+		VF = sum > 0xFF ? 1 : 0;
+		break;
+	}
+	case Operation::OP_8xy5:
+		VF = Vx > Vy ? 1 : 0;
+		Vx -= Vy;
+		break;
+	case Operation::OP_8xy6:
+	{
+		uint8_t value = quirks.shiftUsesVy ? Vy : Vx;
+		VF = value & 0x01;
+		Vx = value >> 1;
+		break;
+	}
+	case Operation::OP_8xy7:
+		VF = Vy > Vx ? 1 : 0;
+		Vx = Vy - Vx;
+		break;
+	case Operation::OP_8xyE:
+	{
+		uint8_t value = quirks.shiftUsesVy ? Vy : Vx;
+		VF = (value & 0x80) >> 7;
+		Vx = value << 1;
+		break;
+	}
+	case Operation::OP_9xy0:
+		PC += Vx != Vy ? 2 : 0;
+		break;
+	case Operation::OP_Annn:
+		I = group.nnn;
+		break;
+	case Operation::OP_Bnnn:
+		PC = group.nnn + V(quirks.jumpUsesVx ? group.x : 0);
+		break;
+	case Operation::OP_Cxnn:
+		Vx = Chip8::NextRandomByte(randStates[lane]) & group.nn;
+		break;
+	case Operation::OP_Dxyn:
+	{
+		uint64_t* laneVideo = &video[lane * Chip8::VIDEO_HEIGHT];
+		uint8_t x = Vx % Chip8::VIDEO_WIDTH;
+		uint8_t y = Vy % Chip8::VIDEO_HEIGHT;
+		uint64_t collision = 0;
+		for (uint8_t row = 0; row < group.n; ++row)
+		{
+			unsigned int line = y + row;
+			if (quirks.spritesWrap)
+			{
+				line %= Chip8::VIDEO_HEIGHT;
+			}
+			else if (line >= Chip8::VIDEO_HEIGHT)
+			{
+				break;
+			}
+
+			uint64_t sprite = static_cast<uint64_t>(Memory(I + row)) << (Chip8::VIDEO_WIDTH - 8);
+			sprite = quirks.spritesWrap ? std::rotr(sprite, x) : sprite >> x;
+
+			collision |= laneVideo[line] & sprite;
+			laneVideo[line] ^= sprite;
+		}
+		VF = collision != 0 ? 1 : 0;
+		break;
+	}
+	case Operation::OP_Ex9E:
+		PC += keypad[lane * Chip8::KEY_COUNT + (Vx & 0xF)] != 0 ? 2 : 0;
+		break;
+	case Operation::OP_ExA1:
+		PC += keypad[lane * Chip8::KEY_COUNT + (Vx & 0xF)] == 0 ? 2 : 0;
+		break;
+	case Operation::OP_Fx07:
+		Vx = delayTimer[lane];
+		break;
+	case Operation::OP_Fx0A:
+	{
+		const uint8_t* keys = &keypad[lane * Chip8::KEY_COUNT];
+		const uint8_t* pressed = std::find_if(keys, keys + Chip8::KEY_COUNT, [](uint8_t key) { return key != 0; });
+		if (pressed != keys + Chip8::KEY_COUNT)
+		{
+			Vx = static_cast<uint8_t>(pressed - keys);
+		}
+		else
+		{
+			PC -= 2;
+		}
+		break;
+	}
+	case Operation::OP_Fx15:
+		delayTimer[lane] = Vx;
+		break;
+	case Operation::OP_Fx18:
+		soundTimer[lane] = Vx;
+		break;
+	case Operation::OP_Fx1E:
+		I += Vx;
+		break;
+	case Operation::OP_Fx29:
+		I = Chip8::FONTSET_START_ADDRESS + Vx * 5;
+		break;
+	case Operation::OP_Fx33:
+	{
+		uint8_t value = Vx;
+		Memory(I) = value / 100;
+		Memory(I + 1) = (value / 10) % 10;
+		Memory(I + 2) = value % 10;
+		break;
+	}
+	case Operation::OP_Fx55:
+	case Operation::OP_Fx65:
+		for (unsigned int i = 0; i <= group.x; ++i)
+		{
+			if (group.operation == Operation::OP_Fx55)
+			{
+				Memory(I + i) = V(i);
+			}
+			else
+			{
+				V(i) = Memory(I + i);
+			}
+		}
+		if (quirks.loadStoreIncrementsIndex)
+		{
+			I += group.x + 1;
+		}
+		break;
+	}
+}
+
+void Chip8Lockstep::TickTimers(unsigned int base)
+{
+	for (unsigned int lane = base; lane < base + BLOCK_LANES; ++lane)
+	{
+		delayTimer[lane] -= delayTimer[lane] > 0 ? 1 : 0;
+		soundTimer[lane] -= soundTimer[lane] > 0 ? 1 : 0;
+	}
+}
+#pragma endregion
+
+#pragma region AVX2
+#if CHIP8_LOCKSTEP_AVX2
+namespace
+{
+	TARGET_AVX2 inline __m256i Load(const void* source)
+	{
+		return _mm256_loadu_si256(static_cast<const __m256i*>(source));
+	}
+
+	TARGET_AVX2 inline void Store(void* target, __m256i value)
+	{
+		_mm256_storeu_si256(static_cast<__m256i*>(target), value);
+	}
+
+	// Write value to the 32 bytes at target, only where mask is set
+	TARGET_AVX2 inline void Store8(uint8_t* target, __m256i value, __m256i mask)
+	{
+		Store(target, _mm256_blendv_epi8(Load(target), value, mask));
+	}
+
+	// Write lo and hi to the 32 words at target, only where the byte mask is set
+	TARGET_AVX2 inline void Store16(uint16_t* target, __m256i lo, __m256i hi, __m256i mask)
+	{
+		Store(target, _mm256_blendv_epi8(Load(target), lo, _mm256_cvtepi8_epi16(_mm256_castsi256_si128(mask))));
+		Store(target + 16, _mm256_blendv_epi8(Load(target + 16), hi, _mm256_cvtepi8_epi16(_mm256_extracti128_si256(mask, 1))));
+	}
+
+	// One byte per lane, 0xFF for the lanes whose bit is set
+	TARGET_AVX2 inline __m256i ByteMask(uint32_t mask)
+	{
+		// Byte i takes mask byte i / 8, shuffles stay within 128-bit halves so both hold the whole mask
+		const __m256i select = _mm256_setr_epi8(
+			0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 1, 1, 1, 1,
+			2, 2, 2, 2, 2, 2, 2, 2, 3, 3, 3, 3, 3, 3, 3, 3);
+		const __m256i bits = _mm256_set1_epi64x(static_cast<long long>(0x8040201008040201ULL));
+		__m256i bytes = _mm256_shuffle_epi8(_mm256_set1_epi32(static_cast<int>(mask)), select);
+		return _mm256_cmpeq_epi8(_mm256_and_si256(bytes, bits), bits);
+	}
+
+	TARGET_AVX2 inline __m256i Not(__m256i value)
+	{
+		return _mm256_xor_si256(value, _mm256_set1_epi8(-1));
+	}
+
+	// Unsigned a > b per byte
+	TARGET_AVX2 inline __m256i Greater(__m256i a, __m256i b)
+	{
+		return Not(_mm256_cmpeq_epi8(_mm256_max_epu8(a, b), b));
+	}
+}
+
+TARGET_AVX2 void Chip8Lockstep::FetchBlockAVX2(unsigned int base)
+{
+	const __m256i addressMask = _mm256_set1_epi16(Chip8::MEMORY_SIZE - 1);
+	unsigned int address = pc[base] & (Chip8::MEMORY_SIZE - 1);
+	__m256i first = _mm256_set1_epi16(static_cast<short>(address));
+	__m256i same = _mm256_and_si256(_mm256_cmpeq_epi16(_mm256_and_si256(Load(&pc[base]), addressMask), first),
+		_mm256_cmpeq_epi16(_mm256_and_si256(Load(&pc[base + 16]), addressMask), first));
+
+	// Lanes that did not diverge read both opcode bytes of the whole block with two loads
+	if (_mm256_movemask_epi8(same) == -1)
+	{
+		__m256i high = Load(&memory[address * laneCount + base]);
+		__m256i low = Load(&memory[((address + 1) & (Chip8::MEMORY_SIZE - 1)) * laneCount + base]);
+		// Unpacking works within 128-bit halves, lo holds lanes 0-7 and 16-23, hi holds lanes 8-15 and 24-31
+		__m256i lo = _mm256_unpacklo_epi8(low, high);
+		__m256i hi = _mm256_unpackhi_epi8(low, high);
+		Store(&opcodes[base], _mm256_permute2x128_si256(lo, hi, 0x20));
+		Store(&opcodes[base + 16], _mm256_permute2x128_si256(lo, hi, 0x31));
+		return;
+	}
+
+	const __m256i laneOffsets = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+	const __m256i wrapMask = _mm256_set1_epi32(Chip8::MEMORY_SIZE - 1);
+	const __m256i byteMask = _mm256_set1_epi32(0xFF);
+	const __m256i stride = _mm256_set1_epi32(static_cast<int>(laneCount));
+	for (unsigned int i = 0; i < BLOCK_LANES; i += 8)
+	{
+		// Gather the opcode bytes of 8 lanes, each gather reads 4 bytes and keeps the first
+		__m256i lanes = _mm256_add_epi32(_mm256_set1_epi32(static_cast<int>(base + i)), laneOffsets);
+		__m256i highAddress = _mm256_and_si256(_mm256_cvtepu16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(&pc[base + i]))), wrapMask);
+		__m256i lowAddress = _mm256_and_si256(_mm256_add_epi32(highAddress, _mm256_set1_epi32(1)), wrapMask);
+		const int* source = reinterpret_cast<const int*>(memory.data());
+		__m256i high = _mm256_i32gather_epi32(source, _mm256_add_epi32(_mm256_mullo_epi32(highAddress, stride), lanes), 1);
+		__m256i low = _mm256_i32gather_epi32(source, _mm256_add_epi32(_mm256_mullo_epi32(lowAddress, stride), lanes), 1);
+
+		__m256i opcode = _mm256_or_si256(_mm256_slli_epi32(_mm256_and_si256(high, byteMask), 8), _mm256_and_si256(low, byteMask));
+		__m256i packed = _mm256_permute4x64_epi64(_mm256_packus_epi32(opcode, opcode), 0x08);
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(&opcodes[base + i]), _mm256_castsi256_si128(packed));
+	}
+}
+
+TARGET_AVX2 uint32_t Chip8Lockstep::MatchOpcodeAVX2(unsigned int base, uint16_t opcode) const
+{
+	__m256i target = _mm256_set1_epi16(static_cast<short>(opcode));
+	__m256i lo = _mm256_cmpeq_epi16(Load(&opcodes[base]), target);
+	__m256i hi = _mm256_cmpeq_epi16(Load(&opcodes[base + 16]), target);
+	// Packing interleaves 128-bit halves, the permutation puts lanes back in order
+	return static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_permute4x64_epi64(_mm256_packs_epi16(lo, hi), 0xD8)));
+}
+
+TARGET_AVX2 bool Chip8Lockstep::ExecuteGroupAVX2(unsigned int base, uint32_t mask, const Group& group)
+{
+	// Key waits and tests only have a vector form when no key is held, calls and returns when lanes share a stack level
+	uint8_t level = 0;
+	switch (group.operation)
+	{
+	case Operation::OP_Ex9E: case Operation::OP_ExA1: case Operation::OP_Fx0A:
+		if (!AreKeysReleasedAVX2(base))
+		{
+			return false;
+		}
+		break;
+	case Operation::OP_2nnn:
+		if (!IsStackUniformAVX2(base, mask, level) || level >= Chip8::STACK_LEVELS)
+		{
+			return false;
+		}
+		break;
+	case Operation::OP_00EE:
+		if (!IsStackUniformAVX2(base, mask, level) || level == 0 || level > Chip8::STACK_LEVELS)
+		{
+			return false;
+		}
+		break;
+	case Operation::OP_1nnn: case Operation::OP_3xnn: case Operation::OP_4xnn: case Operation::OP_5xy0:
+	case Operation::OP_6xnn: case Operation::OP_7xnn: case Operation::OP_8xy0: case Operation::OP_8xy1:
+	case Operation::OP_8xy2: case Operation::OP_8xy3: case Operation::OP_8xy4: case Operation::OP_8xy5:
+	case Operation::OP_8xy6: case Operation::OP_8xy7: case Operation::OP_8xyE: case Operation::OP_9xy0:
+	case Operation::OP_Annn: case Operation::OP_Fx07: case Operation::OP_Fx15: case Operation::OP_Fx18:
+	case Operation::OP_Fx1E: case Operation::OP_Fx29: case Operation::OP_Cxnn:
+		break;
+	default:
+		return false;
+	}
+
+	const __m256i one = _mm256_set1_epi8(1);
+	__m256i lanes = ByteMask(mask);
+	uint8_t* Vx = &registers[group.x * laneCount + base];
+	uint8_t* Vy = &registers[group.y * laneCount + base];
+	uint8_t* VF = &registers[0xF * laneCount + base];
+	// Lanes taking a skip
+	__m256i skip = _mm256_setzero_si256();
+
+	switch (group.operation)
+	{
+	// PC is advanced past the instruction below, like for every other operation, jumps store their target minus 2
+	case Operation::OP_1nnn:
+		Store16(&pc[base], _mm256_set1_epi16(static_cast<short>(group.nnn - 2)), _mm256_set1_epi16(static_cast<short>(group.nnn - 2)), lanes);
+		break;
+	case Operation::OP_2nnn:
+	{
+		const __m256i two = _mm256_set1_epi16(2);
+		Store16(&stack[level * laneCount + base], _mm256_add_epi16(Load(&pc[base]), two), _mm256_add_epi16(Load(&pc[base + 16]), two), lanes);
+		Store8(&sp[base], _mm256_set1_epi8(static_cast<char>(level + 1)), lanes);
+		Store16(&pc[base], _mm256_set1_epi16(static_cast<short>(group.nnn - 2)), _mm256_set1_epi16(static_cast<short>(group.nnn - 2)), lanes);
+		break;
+	}
+	case Operation::OP_00EE:
+	{
+		const __m256i two = _mm256_set1_epi16(2);
+		const uint16_t* returns = &stack[(level - 1) * laneCount + base];
+		Store8(&sp[base], _mm256_set1_epi8(static_cast<char>(level - 1)), lanes);
+		Store16(&pc[base], _mm256_sub_epi16(Load(returns), two), _mm256_sub_epi16(Load(returns + 16), two), lanes);
+		break;
+	}
+	// No key is held: Ex9E never skips, ExA1 always does and Fx0A keeps waiting
+	case Operation::OP_Ex9E:
+		break;
+	case Operation::OP_ExA1:
+		skip = lanes;
+		break;
+	case Operation::OP_Fx0A:
+		Store16(&pc[base], _mm256_sub_epi16(Load(&pc[base]), _mm256_set1_epi16(2)), _mm256_sub_epi16(Load(&pc[base + 16]), _mm256_set1_epi16(2)), lanes);
+		break;
+	case Operation::OP_3xnn:
+		skip = _mm256_cmpeq_epi8(Load(Vx), _mm256_set1_epi8(static_cast<char>(group.nn)));
+		break;
+	case Operation::OP_4xnn:
+		skip = Not(_mm256_cmpeq_epi8(Load(Vx), _mm256_set1_epi8(static_cast<char>(group.nn))));
+		break;
+	case Operation::OP_5xy0:
+		skip = _mm256_cmpeq_epi8(Load(Vx), Load(Vy));
+		break;
+	case Operation::OP_9xy0:
+		skip = Not(_mm256_cmpeq_epi8(Load(Vx), Load(Vy)));
+		break;
+	case Operation::OP_6xnn:
+		Store8(Vx, _mm256_set1_epi8(static_cast<char>(group.nn)), lanes);
+		break;
+	case Operation::OP_7xnn:
+		Store8(Vx, _mm256_add_epi8(Load(Vx), _mm256_set1_epi8(static_cast<char>(group.nn))), lanes);
+		break;
+	case Operation::OP_8xy0:
+		Store8(Vx, Load(Vy), lanes);
+		break;
+	case Operation::OP_8xy1:
+	case Operation::OP_8xy2:
+	case Operation::OP_8xy3:
+	{
+		__m256i x = Load(Vx);
+		__m256i y = Load(Vy);
+		Store8(Vx, group.operation == Operation::OP_8xy1 ? _mm256_or_si256(x, y)
+			: group.operation == Operation::OP_8xy2 ? _mm256_and_si256(x, y) : _mm256_xor_si256(x, y), lanes);
+		if (quirks.logicResetsVF)
+		{
+			Store8(VF, _mm256_setzero_si256(), lanes);
+		}
+		break;
+	}
+	case Operation::OP_8xy4:
+	{
+		__m256i x = Load(Vx);
+		__m256i y = Load(Vy);
+		__m256i sum = _mm256_add_epi8(x, y);
+		// The saturated sum only differs from the wrapped one on carry
+		__m256i carry = Not(_mm256_cmpeq_epi8(_mm256_adds_epu8(x, y), sum));
+		Store8(Vx, sum, lanes);
+		Store8(VF, _mm256_and_si256(carry, one), lanes);
+		break;
+	}
+	// VF is written first, then Vx is computed again from registers that may include VF
+	case Operation::OP_8xy5:
+		Store8(VF, _mm256_and_si256(Greater(Load(Vx), Load(Vy)), one), lanes);
+		Store8(Vx, _mm256_sub_epi8(Load(Vx), Load(Vy)), lanes);
+		break;
+	case Operation::OP_8xy7:
+		Store8(VF, _mm256_and_si256(Greater(Load(Vy), Load(Vx)), one), lanes);
+		Store8(Vx, _mm256_sub_epi8(Load(Vy), Load(Vx)), lanes);
+		break;
+	case Operation::OP_8xy6:
+	{
+		__m256i value = Load(quirks.shiftUsesVy ? Vy : Vx);
+		Store8(VF, _mm256_and_si256(value, one), lanes);
+		// There is no byte shift, bits crossing from the neighbouring byte are masked out
+		Store8(Vx, _mm256_and_si256(_mm256_srli_epi16(value, 1), _mm256_set1_epi8(0x7F)), lanes);
+		break;
+	}
+	case Operation::OP_8xyE:
+	{
+		__m256i value = Load(quirks.shiftUsesVy ? Vy : Vx);
+		Store8(VF, _mm256_and_si256(_mm256_srli_epi16(value, 7), one), lanes);
+		Store8(Vx, _mm256_add_epi8(value, value), lanes);
+		break;
+	}
+	case Operation::OP_Cxnn:
+	{
+		// Step the xorshift32 state of the selected lanes, 8 lanes per vector, and keep the top byte
+		__m256i bytes[4];
+		for (unsigned int i = 0; i < 4; ++i)
+		{
+			uint32_t* states = &randStates[base + i * 8];
+			__m256i laneMask = _mm256_cvtepi8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(reinterpret_cast<const uint8_t*>(&lanes) + i * 8)));
+			__m256i value = Load(states);
+			value = _mm256_xor_si256(value, _mm256_slli_epi32(value, 13));
+			value = _mm256_xor_si256(value, _mm256_srli_epi32(value, 17));
+			value = _mm256_xor_si256(value, _mm256_slli_epi32(value, 5));
+			Store(states, _mm256_blendv_epi8(Load(states), value, laneMask));
+			bytes[i] = _mm256_srli_epi32(value, 24);
+		}
+		// Packing interleaves 128-bit halves, the permutation puts the 4-byte runs back in lane order
+		__m256i packed = _mm256_packus_epi16(_mm256_packus_epi32(bytes[0], bytes[1]), _mm256_packus_epi32(bytes[2], bytes[3]));
+		packed = _mm256_permutevar8x32_epi32(packed, _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7));
+		Store8(Vx, _mm256_and_si256(packed, _mm256_set1_epi8(static_cast<char>(group.nn))), lanes);
+		break;
+	}
+	case Operation::OP_Annn:
+		Store16(&index[base], _mm256_set1_epi16(static_cast<short>(group.nnn)), _mm256_set1_epi16(static_cast<short>(group.nnn)), lanes);
+		break;
+	case Operation::OP_Fx07:
+		Store8(Vx, Load(&delayTimer[base]), lanes);
+		break;
+	case Operation::OP_Fx15:
+		Store8(&delayTimer[base], Load(Vx), lanes);
+		break;
+	case Operation::OP_Fx18:
+		Store8(&soundTimer[base], Load(Vx), lanes);
+		break;
+	case Operation::OP_Fx1E:
+	{
+		__m256i x = Load(Vx);
+		Store16(&index[base], _mm256_add_epi16(Load(&index[base]), _mm256_cvtepu8_epi16(_mm256_castsi256_si128(x))),
+			_mm256_add_epi16(Load(&index[base + 16]), _mm256_cvtepu8_epi16(_mm256_extracti128_si256(x, 1))), lanes);
+		break;
+	}
+	case Operation::OP_Fx29:
+	{
+		const __m256i font = _mm256_set1_epi16(Chip8::FONTSET_START_ADDRESS);
+		const __m256i height = _mm256_set1_epi16(5);
+		__m256i x = Load(Vx);
+		Store16(&index[base], _mm256_add_epi16(font, _mm256_mullo_epi16(_mm256_cvtepu8_epi16(_mm256_castsi256_si128(x)), height)),
+			_mm256_add_epi16(font, _mm256_mullo_epi16(_mm256_cvtepu8_epi16(_mm256_extracti128_si256(x, 1)), height)), lanes);
+		break;
+	}
+	default:
+		break;
+	}
+
+	// Advance PC past the instruction, and past the next one for the lanes taking a skip
+	__m256i advance = _mm256_and_si256(_mm256_add_epi8(_mm256_and_si256(skip, one), one), lanes);
+	Store(&pc[base], _mm256_add_epi16(Load(&pc[base]), _mm256_slli_epi16(_mm256_cvtepu8_epi16(_mm256_castsi256_si128(advance)), 1)));
+	Store(&pc[base + 16], _mm256_add_epi16(Load(&pc[base + 16]), _mm256_slli_epi16(_mm256_cvtepu8_epi16(_mm256_extracti128_si256(advance, 1)), 1)));
+
+	return true;
+}
+
+TARGET_AVX2 void Chip8Lockstep::TickTimersAVX2(unsigned int base)
+{
+	const __m256i one = _mm256_set1_epi8(1);
+	Store(&delayTimer[base], _mm256_subs_epu8(Load(&delayTimer[base]), one));
+	Store(&soundTimer[base], _mm256_subs_epu8(Load(&soundTimer[base]), one));
+}
+
+TARGET_AVX2 bool Chip8Lockstep::AreKeysReleasedAVX2(unsigned int base) const
+{
+	const uint8_t* keys = &keypad[base * Chip8::KEY_COUNT];
+	__m256i held = _mm256_setzero_si256();
+	for (unsigned int i = 0; i < BLOCK_LANES * Chip8::KEY_COUNT; i += sizeof(__m256i))
+	{
+		held = _mm256_or_si256(held, Load(keys + i));
+	}
+	return _mm256_testz_si256(held, held) != 0;
+}
+
+TARGET_AVX2 bool Chip8Lockstep::IsStackUniformAVX2(unsigned int base, uint32_t mask, uint8_t& level) const
+{
+	level = sp[base + std::countr_zero(mask)];
+	uint32_t same = static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(Load(&sp[base]), _mm256_set1_epi8(static_cast<char>(level)))));
+	return (same & mask) == mask;
+}
+#else
+void Chip8Lockstep::FetchBlockAVX2(unsigned int base)
+{
+	FetchBlock(base);
+}
+
+uint32_t Chip8Lockstep::MatchOpcodeAVX2(unsigned int base, uint16_t opcode) const
+{
+	return MatchOpcode(base, opcode);
+}
+
+bool Chip8Lockstep::ExecuteGroupAVX2(unsigned int, uint32_t, const Group&)
+{
+	return false;
+}
+
+void Chip8Lockstep::TickTimersAVX2(unsigned int base)
+{
+	TickTimers(base);
+}
+
+bool Chip8Lockstep::AreKeysReleasedAVX2(unsigned int) const
+{
+	return false;
+}
+
+bool Chip8Lockstep::IsStackUniformAVX2(unsigned int, uint32_t, uint8_t&) const
+{
+	return false;
+}
+#endif
+#pragma endregion
\ No newline at end of file
@@ -0,0 +1,308 @@
+#include "Chip8Movie.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+namespace
+{
+	constexpr uint8_t MAGIC[4] = { 'C', '8', 'M', 'V' };
+	constexpr size_t HEADER_SIZE = sizeof(MAGIC) + sizeof(uint16_t) + sizeof(uint8_t) + 2 * sizeof(uint32_t) + 3 * sizeof(uint64_t)
+		+ sizeof(uint32_t);
+
+	template <typename T>
+	void StoreField(std::vector<uint8_t>& out, T value)
+	{
+		for (size_t i = 0; i < sizeof(T); ++i)
+		{
+			out.push_back(static_cast<uint8_t>(value >> (8 * i)));
+		}
+	}
+
+	template <typename T>
+	const uint8_t* LoadField(const uint8_t* in, T& value)
+	{
+		value = 0;
+		for (size_t i = 0; i < sizeof(T); ++i)
+		{
+			value |= static_cast<T>(static_cast<T>(*in++) << (8 * i));
+		}
+		return in;
+	}
+
+	// 7 bits per byte, low bits first, the top bit set on every byte but the last
+	void StoreVarint(std::vector<uint8_t>& out, uint64_t value)
+	{
+		while (value >= 0x80)
+		{
+			out.push_back(static_cast<uint8_t>(value | 0x80));
+			value >>= 7;
+		}
+		out.push_back(static_cast<uint8_t>(value));
+	}
+
+	// Returns nullptr when the varint runs past end
+	const uint8_t* LoadVarint(const uint8_t* in, const uint8_t* end, uint64_t& value)
+	{
+		value = 0;
+		for (unsigned int shift = 0; in < end && shift < 64; shift += 7)
+		{
+			uint8_t byte = *in++;
+			value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+			if ((byte & 0x80) == 0)
+			{
+				return in;
+			}
+		}
+		return nullptr;
+	}
+}
+
+bool Chip8Movie::StartRecording(const Chip8& chip8, uint32_t movieSeed)
+{
+	if (chip8.GetCycleCount() != 0)
+	{
+		std::cerr << "A movie must start right after the ROM is loaded." << std::endl;
+		return false;
+	}
+
+	profile = chip8.GetQuirkProfile();
+	tickCycles = chip8.GetTickCycles();
+	seed = movieSeed;
+	romHash = chip8.GetROMHash();
+	length = 0;
+	videoHash = 0;
+	events.clear();
+	recordedKeypad = 0;
+	recording = true;
+
+	// Keys held from the start
+	Record(chip8);
+	return true;
+}
+
+void Chip8Movie::Record(const Chip8& chip8)
+{
+	uint16_t keypad = PackKeypad(chip8.GetKeypad());
+	if (!recording || keypad == recordedKeypad)
+	{
+		return;
+	}
+
+	recordedKeypad = keypad;
+	if (!events.empty() && events.back().cycle == chip8.GetCycleCount())
+	{
+		events.back().keypad = keypad;
+	}
+	else
+	{
+		events.push_back({ chip8.GetCycleCount(), keypad });
+	}
+}
+
+void Chip8Movie::Truncate(const Chip8& chip8)
+{
+	if (!recording)
+	{
+		return;
+	}
+
+	while (!events.empty() && events.back().cycle > chip8.GetCycleCount())
+	{
+		events.pop_back();
+	}
+	recordedKeypad = events.empty() ? 0 : events.back().keypad;
+	Record(chip8);
+}
+
+void Chip8Movie::StopRecording(const Chip8& chip8)
+{
+	if (!recording)
+	{
+		return;
+	}
+
+	recording = false;
+	length = chip8.GetCycleCount();
+	videoHash = chip8.GetVideoHash();
+}
+
+bool Chip8Movie::StartReplay(Chip8& chip8)
+{
+	if (chip8.GetROMHash() != romHash || chip8.GetCycleCount() != 0)
+	{
+		std::cerr << "The movie was recorded with another ROM." << std::endl;
+		return false;
+	}
+
+	if (chip8.GetQuirkProfile() != profile)
+	{
+		chip8.SetQuirkProfile(profile);
+	}
+	chip8.SetTickCycles(tickCycles);
+	chip8.SetRandomSeed(seed);
+	memset(chip8.GetKeypad(), 0, Chip8::KEY_COUNT);
+	nextEvent = 0;
+	return true;
+}
+
+Chip8::RunResult Chip8Movie::Replay(Chip8& chip8, unsigned int cycles)
+{
+	Chip8::RunResult result;
+	uint64_t end = std::min(chip8.GetCycleCount() + cycles, length);
+	bool soundWasActive = chip8.GetSoundTimer() > 0;
+	while (true)
+	{
+		for (; nextEvent < events.size() && events[nextEvent].cycle <= chip8.GetCycleCount(); ++nextEvent)
+		{
+			for (unsigned int key = 0; key < Chip8::KEY_COUNT; ++key)
+			{
+				chip8.GetKeypad()[key] = (events[nextEvent].keypad >> key) & 1;
+			}
+		}
+
+		// Run in one batch up to the next change
+		uint64_t until = nextEvent < events.size() ? std::min(end, events[nextEvent].cycle) : end;
+		if (until <= chip8.GetCycleCount())
+		{
+			break;
+		}
+
+		Chip8::RunResult batch = chip8.RunCycles(static_cast<unsigned int>(until - chip8.GetCycleCount()));
+		result.cycles += batch.cycles;
+		result.haltedCycles += batch.haltedCycles;
+		result.displayChanged |= batch.displayChanged;
+		result.soundActive |= batch.soundActive;
+		result.waitingForKey = batch.waitingForKey;
+	}
+
+	result.soundStarted = !soundWasActive && result.soundActive;
+	result.soundStopped = result.soundActive && chip8.GetSoundTimer() == 0;
+	return result;
+}
+
+void Chip8Movie::Serialize(std::vector<uint8_t>& data) const
+{
+	data.assign(MAGIC, MAGIC + sizeof(MAGIC));
+	StoreField(data, VERSION);
+	StoreField(data, static_cast<uint8_t>(profile));
+	StoreField(data, static_cast<uint32_t>(tickCycles));
+	StoreField(data, seed);
+	StoreField(data, romHash);
+	StoreField(data, length);
+	StoreField(data, videoHash);
+	StoreField(data, static_cast<uint32_t>(events.size()));
+
+	uint64_t cycle = 0;
+	for (const Event& event : events)
+	{
+		StoreVarint(data, event.cycle - cycle);
+		StoreField(data, event.keypad);
+		cycle = event.cycle;
+	}
+}
+
+bool Chip8Movie::Deserialize(const uint8_t* data, size_t size)
+{
+	if (size < HEADER_SIZE || memcmp(data, MAGIC, sizeof(MAGIC)) != 0)
+	{
+		std::cerr << "Not a movie." << std::endl;
+		return false;
+	}
+
+	const uint8_t* in = data + sizeof(MAGIC);
+	const uint8_t* end = data + size;
+	uint16_t version;
+	uint8_t movieProfile;
+	uint32_t movieTickCycles;
+	uint32_t eventCount;
+	in = LoadField(in, version);
+	if (version != VERSION)
+	{
+		std::cerr << "Unsupported movie version: " << version << std::endl;
+		return false;
+	}
+	in = LoadField(in, movieProfile);
+	in = LoadField(in, movieTickCycles);
+	in = LoadField(in, seed);
+	in = LoadField(in, romHash);
+	in = LoadField(in, length);
+	in = LoadField(in, videoHash);
+	in = LoadField(in, eventCount);
+	if (movieProfile > static_cast<uint8_t>(QuirkProfile::XOChip) || movieTickCycles == 0)
+	{
+		std::cerr << "Corrupted movie." << std::endl;
+		return false;
+	}
+	profile = static_cast<QuirkProfile>(movieProfile);
+	tickCycles = movieTickCycles;
+
+	events.clear();
+	uint64_t cycle = 0;
+	for (uint32_t i = 0; i < eventCount; ++i)
+	{
+		uint64_t delta;
+		in = LoadVarint(in, end, delta);
+		if (in == nullptr || end - in < static_cast<ptrdiff_t>(sizeof(uint16_t)))
+		{
+			std::cerr << "Truncated movie." << std::endl;
+			events.clear();
+			return false;
+		}
+
+		Event event;
+		cycle += delta;
+		event.cycle = cycle;
+		in = LoadField(in, event.keypad);
+		events.push_back(event);
+	}
+
+	recording = false;
+	nextEvent = 0;
+	return true;
+}
+
+bool Chip8Movie::Save(const std::string& filename) const
+{
+	std::vector<uint8_t> data;
+	Serialize(data);
+
+	std::ofstream file(filename, std::ios::binary);
+	if (!file || !file.write(reinterpret_cast<const char*>(data.data()), data.size()))
+	{
+		std::cerr << "Failed to write movie: " << filename << std::endl;
+		return false;
+	}
+	return true;
+}
+
+bool Chip8Movie::Load(const std::string& filename)
+{
+	std::ifstream file(filename, std::ios::binary | std::ios::ate);
+	if (!file)
+	{
+		std::cerr << "Failed to load movie: " << filename << std::endl;
+		return false;
+	}
+
+	std::streamsize size = file.tellg();
+	file.seekg(0, std::ios::beg);
+	std::vector<uint8_t> data(static_cast<size_t>(size));
+	if (!file.read(reinterpret_cast<char*>(data.data()), size))
+	{
+		std::cerr << "Failed to read movie: " << filename << std::endl;
+		return false;
+	}
+	return Deserialize(data.data(), data.size());
+}
+
+uint16_t Chip8Movie::PackKeypad(const uint8_t* keypad)
+{
+	uint16_t mask = 0;
+	for (unsigned int key = 0; key < Chip8::KEY_COUNT; ++key)
+	{
+		mask |= static_cast<uint16_t>((keypad[key] != 0) << key);
+	}
+	return mask;
+}
\ No newline at end of file
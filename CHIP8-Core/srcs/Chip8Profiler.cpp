@@ -0,0 +1,198 @@
+#include "Chip8Profiler.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+namespace
+{
+	constexpr const char* OPCODE_CLASS_NAMES[Chip8Profiler::OPCODE_CLASS_COUNT] =
+	{
+		"00E0", "00EE", "1nnn", "2nnn", "3xnn", "4xnn", "5xy0", "6xnn", "7xnn",
+		"8xy0", "8xy1", "8xy2", "8xy3", "8xy4", "8xy5", "8xy6", "8xy7", "8xyE",
+		"9xy0", "Annn", "Bnnn", "Cxnn", "Dxyn", "Ex9E", "ExA1",
+		"Fx07", "Fx0A", "Fx15", "Fx18", "Fx1E", "Fx29", "Fx33", "Fx55", "Fx65",
+		"invalid"
+	};
+
+	// First class of each group sharing a leading nibble
+	constexpr unsigned int CLASS_8XY0 = 9;
+	constexpr unsigned int CLASS_9XY0 = 18;
+	constexpr unsigned int CLASS_EX9E = 23;
+	constexpr unsigned int CLASS_FX07 = 25;
+
+	// Insert item into the size busiest items held in items, sorted and at most capacity of them, returns the new size
+	// Summaries are built every frame, this never allocates
+	template <typename T, typename Busier>
+	size_t InsertBusiest(T* items, size_t size, size_t capacity, const T& item, Busier busier)
+	{
+		size_t position = size;
+		while (position > 0 && busier(item, items[position - 1]))
+		{
+			--position;
+		}
+		if (position >= capacity)
+		{
+			return size;
+		}
+
+		size = std::min(size + 1, capacity);
+		for (size_t i = size - 1; i > position; --i)
+		{
+			items[i] = items[i - 1];
+		}
+		items[position] = item;
+		return size;
+	}
+
+	// Percentage of total, 0 when nothing ran
+	double Share(uint64_t count, uint64_t total)
+	{
+		return total > 0 ? 100.0 * count / total : 0.0;
+	}
+}
+
+unsigned int Chip8Profiler::GetOpcodeClass(uint16_t opcode)
+{
+	switch (opcode >> 12)
+	{
+	case 0x0:
+		return opcode == 0x00E0 ? 0 : opcode == 0x00EE ? 1 : INVALID_OPCODE_CLASS;
+	case 0x8:
+		switch (opcode & 0x000F)
+		{
+		case 0x0: case 0x1: case 0x2: case 0x3: case 0x4: case 0x5: case 0x6: case 0x7:
+			return CLASS_8XY0 + (opcode & 0x000F);
+		case 0xE: return CLASS_8XY0 + 8;
+		default: return INVALID_OPCODE_CLASS;
+		}
+	case 0xE:
+		switch (opcode & 0x00FF)
+		{
+		case 0x9E: return CLASS_EX9E;
+		case 0xA1: return CLASS_EX9E + 1;
+		default: return INVALID_OPCODE_CLASS;
+		}
+	case 0xF:
+		switch (opcode & 0x00FF)
+		{
+		case 0x07: return CLASS_FX07;
+		case 0x0A: return CLASS_FX07 + 1;
+		case 0x15: return CLASS_FX07 + 2;
+		case 0x18: return CLASS_FX07 + 3;
+		case 0x1E: return CLASS_FX07 + 4;
+		case 0x29: return CLASS_FX07 + 5;
+		case 0x33: return CLASS_FX07 + 6;
+		case 0x55: return CLASS_FX07 + 7;
+		case 0x65: return CLASS_FX07 + 8;
+		default: return INVALID_OPCODE_CLASS;
+		}
+	default:
+		// 1nnn to 7xnn follow 00EE, 9xy0 to Dxyn follow 8xyE
+		return opcode >> 12 < 0x8 ? 1 + (opcode >> 12) : CLASS_9XY0 + (opcode >> 12) - 0x9;
+	}
+}
+
+const char* Chip8Profiler::GetOpcodeClassName(unsigned int opcodeClass)
+{
+	return opcodeClass < OPCODE_CLASS_COUNT ? OPCODE_CLASS_NAMES[opcodeClass] : "";
+}
+
+void Chip8Profiler::Reset()
+{
+	instructions = 0;
+	memset(opcodeExecutions, 0, sizeof(opcodeExecutions));
+	memset(addressExecutions, 0, sizeof(addressExecutions));
+	memset(addressOpcodes, 0, sizeof(addressOpcodes));
+	memset(loopIterations, 0, sizeof(loopIterations));
+	memset(loopStarts, 0, sizeof(loopStarts));
+	drawNS = 0;
+}
+
+void Chip8Profiler::Summarize(Summary& summary) const
+{
+	summary.instructions = instructions;
+	memcpy(summary.opcodeExecutions, opcodeExecutions, sizeof(summary.opcodeExecutions));
+	summary.hotspotCount = static_cast<unsigned int>(GetHotspots(summary.hotspots, SUMMARY_HOTSPOTS));
+	summary.loopCount = static_cast<unsigned int>(GetLoops(summary.loops, SUMMARY_LOOPS));
+	summary.drawNS = drawNS;
+}
+
+void Chip8Profiler::WriteCSV(std::ostream& out) const
+{
+	char line[128];
+	out << "section,name,opcode,executions,share,iterations,time_ns\n";
+
+	unsigned int classes[OPCODE_CLASS_COUNT];
+	for (unsigned int i = 0; i < OPCODE_CLASS_COUNT; ++i)
+	{
+		classes[i] = i;
+	}
+	std::stable_sort(classes, classes + OPCODE_CLASS_COUNT,
+		[this](unsigned int a, unsigned int b) { return opcodeExecutions[a] > opcodeExecutions[b]; });
+	for (unsigned int opcodeClass : classes)
+	{
+		if (opcodeExecutions[opcodeClass] == 0)
+		{
+			break;
+		}
+		// Only sprite drawing is timed
+		bool draw = opcodeClass == GetOpcodeClass(0xD000);
+		snprintf(line, sizeof(line), "opcode,%s,,%llu,%.3f,,%s", OPCODE_CLASS_NAMES[opcodeClass],
+			static_cast<unsigned long long>(opcodeExecutions[opcodeClass]), Share(opcodeExecutions[opcodeClass], instructions),
+			draw ? std::to_string(drawNS).c_str() : "");
+		out << line << '\n';
+	}
+
+	std::vector<Hotspot> hotspots(Chip8::MEMORY_SIZE);
+	hotspots.resize(GetHotspots(hotspots.data(), hotspots.size()));
+	for (const Hotspot& hotspot : hotspots)
+	{
+		snprintf(line, sizeof(line), "address,0x%03X,%04X,%llu,%.3f,,", hotspot.address, hotspot.opcode,
+			static_cast<unsigned long long>(hotspot.executions), Share(hotspot.executions, instructions));
+		out << line << '\n';
+	}
+
+	std::vector<Loop> loops(Chip8::MEMORY_SIZE);
+	loops.resize(GetLoops(loops.data(), loops.size()));
+	for (const Loop& loop : loops)
+	{
+		snprintf(line, sizeof(line), "loop,0x%03X-0x%03X,,%llu,%.3f,%llu,", loop.start, loop.end,
+			static_cast<unsigned long long>(loop.instructions), Share(loop.instructions, instructions),
+			static_cast<unsigned long long>(loop.iterations));
+		out << line << '\n';
+	}
+}
+
+size_t Chip8Profiler::GetHotspots(Hotspot* hotspots, size_t count) const
+{
+	size_t found = 0;
+	for (unsigned int address = 0; address < Chip8::MEMORY_SIZE; ++address)
+	{
+		if (addressExecutions[address] > 0)
+		{
+			found = InsertBusiest(hotspots, found, count, { static_cast<uint16_t>(address), addressOpcodes[address], addressExecutions[address] },
+				[](const Hotspot& a, const Hotspot& b) { return a.executions > b.executions; });
+		}
+	}
+	return found;
+}
+
+size_t Chip8Profiler::GetLoops(Loop* loops, size_t count) const
+{
+	size_t found = 0;
+	for (unsigned int end = 0; end < Chip8::MEMORY_SIZE; ++end)
+	{
+		if (loopIterations[end] > 0)
+		{
+			Loop loop = { loopStarts[end], static_cast<uint16_t>(end), loopIterations[end], 0 };
+			for (unsigned int address = loop.start; address <= end; ++address)
+			{
+				loop.instructions += addressExecutions[address];
+			}
+			found = InsertBusiest(loops, found, count, loop, [](const Loop& a, const Loop& b) { return a.instructions > b.instructions; });
+		}
+	}
+	return found;
+}
\ No newline at end of file
@@ -0,0 +1,83 @@
+#include "Chip8Recompiled.h"
+
+#include <cstring>
+#include <utility>
+#include <vector>
+
+#include "Chip8.h"
+
+namespace
+{
+	std::vector<Chip8Recompiled::CompiledROM>& GetRegistry()
+	{
+		static std::vector<Chip8Recompiled::CompiledROM> registry;
+		return registry;
+	}
+}
+
+Chip8Recompiled::Registrar::Registrar(const CompiledROM& rom)
+{
+	GetRegistry().push_back(rom);
+}
+
+const Chip8Recompiled::CompiledROM* Chip8Recompiled::Find(const uint8_t* image, size_t size, QuirkProfile profile)
+{
+	for (const CompiledROM& rom : GetRegistry())
+	{
+		if (rom.profile == profile && rom.size == size && std::memcmp(rom.image, image, size) == 0)
+		{
+			return &rom;
+		}
+	}
+
+	return nullptr;
+}
+
+Chip8Recompiled::State Chip8Recompiled::GetState(Chip8& chip8)
+{
+	return { chip8.state.registers, chip8.state.memory, chip8.state.index, chip8.state.pc, chip8.state.stack, chip8.state.sp,
+		chip8.state.delayTimer, chip8.state.soundTimer, chip8.state.keypad };
+}
+
+void Chip8Recompiled::Execute(Chip8& chip8, uint16_t opcode)
+{
+	const Chip8::Instruction& instruction = chip8.opcodeTable[opcode];
+	(chip8.*instruction.handler)(instruction);
+}
+
+bool Chip8Recompiled::IsActive(const Chip8& chip8)
+{
+	return chip8.compiledROM != nullptr;
+}
+
+Chip8Recompiled::Operation Chip8Recompiled::GetOperation(uint16_t opcode)
+{
+	// Each operation is identified by the handler of one opcode decoding to it
+	static const std::pair<uint16_t, Operation> operations[] =
+	{
+		{ 0x00E0, Operation::OP_00E0 }, { 0x00EE, Operation::OP_00EE }, { 0x1000, Operation::OP_1nnn },
+		{ 0x2000, Operation::OP_2nnn }, { 0x3000, Operation::OP_3xnn }, { 0x4000, Operation::OP_4xnn },
+		{ 0x5000, Operation::OP_5xy0 }, { 0x6000, Operation::OP_6xnn }, { 0x7000, Operation::OP_7xnn },
+		{ 0x8000, Operation::OP_8xy0 }, { 0x8001, Operation::OP_8xy1 }, { 0x8002, Operation::OP_8xy2 },
+		{ 0x8003, Operation::OP_8xy3 }, { 0x8004, Operation::OP_8xy4 }, { 0x8005, Operation::OP_8xy5 },
+		{ 0x8006, Operation::OP_8xy6 }, { 0x8007, Operation::OP_8xy7 }, { 0x800E, Operation::OP_8xyE },
+		{ 0x9000, Operation::OP_9xy0 }, { 0xA000, Operation::OP_Annn }, { 0xB000, Operation::OP_Bnnn },
+		{ 0xC000, Operation::OP_Cxnn }, { 0xD000, Operation::OP_Dxyn }, { 0xE09E, Operation::OP_Ex9E },
+		{ 0xE0A1, Operation::OP_ExA1 }, { 0xF007, Operation::OP_Fx07 }, { 0xF00A, Operation::OP_Fx0A },
+		{ 0xF015, Operation::OP_Fx15 }, { 0xF018, Operation::OP_Fx18 }, { 0xF01E, Operation::OP_Fx1E },
+		{ 0xF029, Operation::OP_Fx29 }, { 0xF033, Operation::OP_Fx33 }, { 0xF055, Operation::OP_Fx55 },
+		{ 0xF065, Operation::OP_Fx65 }
+	};
+
+	// Every profile decodes opcodes to the same operations
+	const Chip8::Instruction* table = Chip8::GetOpcodeTable(QuirkProfile::SuperChip);
+	for (const auto& [representative, operation] : operations)
+	{
+		if (table[opcode].handler == table[representative].handler)
+		{
+			return operation;
+		}
+	}
+
+	return Operation::OP_NULL;
+}
\ No newline at end of file
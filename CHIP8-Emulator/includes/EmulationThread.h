@@ -0,0 +1,248 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Chip8.h"
+#include "Chip8CallGraph.h"
+#include "Chip8Movie.h"
+#include "Chip8Profiler.h"
+#include "RewindBuffer.h"
+#include "SaveStateFiles.h"
+#include "SpscQueue.h"
+#include "TripleBuffer.h"
+
+// Runs a Chip8 on a dedicated thread, one frame per timer tick at its own pace, independently of rendering.
+// The GUI thread sends commands through a lock-free queue and reads completed frames from a lock-free triple buffer,
+// it never touches the Chip8 itself.
+// Key events carry the host time they happened at, each frame maps the host time elapsed since the previous one
+// onto the instructions it runs, and a key change applies at the instruction matching its timestamp.
+// With run-ahead, the published frame is the one a few frames in the future with the keys held now,
+// the machine then goes back to its snapshot so the ROM reacts to input that many frames earlier on screen.
+// Every frame is also recorded in a rewind buffer, while rewinding each frame steps one recorded frame back instead.
+// A movie records the keypad changes of a run from a fresh ROM load, replaying it runs the same instructions with the same keys.
+class EmulationThread
+{
+public:
+	// Input latency histogram, from a key event to the publication of the first frame that saw it
+	static constexpr unsigned int INPUT_LATENCY_BUCKETS = 40;
+	static constexpr uint64_t INPUT_LATENCY_BUCKET_NS = 1'000'000;
+	static constexpr unsigned int MAX_RUN_AHEAD_FRAMES = 8;
+	static constexpr unsigned int SAVE_STATE_SLOTS = 4;
+	// Savestates of a ROM are stored here as <ROM name>.<slot>.state
+	static constexpr const char* SAVE_STATE_FOLDER = "saves/";
+	// Five minutes of history, a few megabytes for most ROMs
+	static constexpr size_t REWIND_ARENA_BYTES = 8 << 20;
+	static constexpr unsigned int REWIND_FRAMES = 5 * 60 * Chip8::TIMER_FREQUENCY;
+	static constexpr unsigned int REWIND_KEYFRAME_INTERVAL = Chip8::TIMER_FREQUENCY;
+	// The movie of a ROM is stored here as <ROM name>.c8m
+	static constexpr const char* MOVIE_FOLDER = "movies/";
+	// Execution profiles are exported here as <ROM name>.csv and call graphs as <ROM name>.folded
+	static constexpr const char* PROFILE_FOLDER = "profiles/";
+
+	// Snapshot of the machine published after every frame
+	struct Frame
+	{
+		uint64_t video[Chip8::VIDEO_HEIGHT];
+		uint8_t registers[Chip8::REGISTER_COUNT];
+		uint64_t frameNumber;
+		// Frames during which the sound timer ran, a beep is due whenever it grows
+		uint64_t soundFrames;
+		// Key events per latency bucket since the start, the last bucket also counts the slower ones
+		uint32_t inputLatency[INPUT_LATENCY_BUCKETS];
+		// Cost of run-ahead over the last second: instructions emulated ahead and thread time spent on it
+		uint64_t runAheadCyclesPerSecond;
+		uint64_t runAheadNSPerSecond;
+		// Rewind history held, its size and the mean cost of recording a frame and of stepping one back
+		unsigned int rewindFrames;
+		size_t rewindBytes;
+		uint64_t rewindPushNS;
+		uint64_t rewindStepNS;
+		bool recordingMovie;
+		bool replayingMovie;
+		// Busiest parts of the execution profile, valid while profiling
+		bool profiling;
+		Chip8Profiler::Summary profile;
+		// Hottest guest subroutines, valid while following calls
+		bool callGraphing;
+		Chip8CallGraph::Summary callGraph;
+	};
+
+	struct Command
+	{
+		enum class Type : uint8_t
+		{
+			Key,
+			LoadROM,
+			Configure,
+			SaveState,
+			LoadState,
+			Rewind,
+			RecordMovie,
+			ReplayMovie,
+			Profile,
+			CallGraph,
+			ResetProfile,
+			ExportProfile
+		};
+
+		// timestampNS is on the SDL_GetTicksNS clock, like SDL event timestamps
+		static Command Key(uint8_t key, bool pressed, uint64_t timestampNS);
+		// Reset and load a ROM, the quirk profile is selected first
+		static Command LoadROM(const std::string& romPath, QuirkProfile profile);
+		static Command Configure(unsigned int tickCycles, bool fusion, bool jit, unsigned int runAheadFrames, bool rewind);
+		// Savestate slots of the loaded ROM, kept in memory and written to disk in the background
+		static Command SaveState(unsigned int slot);
+		static Command LoadState(unsigned int slot);
+		// Step back through the recorded frames while held
+		static Command Rewind(bool held);
+		// Start recording the movie of the loaded ROM from a reset, or stop and write it
+		static Command RecordMovie();
+		// Reset and replay the movie of the loaded ROM, or stop replaying and keep playing from there
+		static Command ReplayMovie();
+		// Count instructions per opcode class and address, native code engines are bypassed while profiling
+		// Frames run ahead are counted too, every time they run
+		static Command Profile(bool enabled);
+		// Follow guest calls and returns, native code engines are bypassed as well
+		static Command CallGraph(bool enabled);
+		// Clears the profile and the call graph
+		static Command ResetProfile();
+		// Write the profile of the loaded ROM as CSV and its call graph as folded stacks in the background
+		static Command ExportProfile();
+
+		Type type = Type::Key;
+		uint8_t key = 0;
+		bool pressed = false;
+		uint64_t timestampNS = 0;
+		std::string romPath;
+		QuirkProfile profile = QuirkProfile::SuperChip;
+		unsigned int tickCycles = Chip8::DEFAULT_TICK_CYCLES;
+		bool fusion = true;
+		bool jit = false;
+		unsigned int runAheadFrames = 0;
+		bool rewind = true;
+		unsigned int slot = 0;
+	};
+
+	EmulationThread();
+	~EmulationThread();
+
+	// Load the first ROM on the calling thread, then start emulating
+	bool Start(const std::string& romPath, QuirkProfile profile);
+	void Stop();
+
+	// Returns false when the queue is full and the command was dropped
+	bool Send(Command command) { return commands.Push(std::move(command)); }
+	// Frames emulated per second, one timer tick each
+	void SetFrameRate(unsigned int rate) { frameRate.store(rate, std::memory_order_relaxed); }
+	// Latest completed frame, valid until the next call
+	const Frame& ReadFrame() { return frames.Read(); }
+
+	// True once a ROM failed to load, emulation stopped
+	bool HasFailed() const { return failed.load(std::memory_order_acquire); }
+	bool IsJITAvailable() const { return jitAvailable; }
+	// False when the core was built without CHIP8_PROFILER
+	bool IsProfilerAvailable() const { return profilerAvailable; }
+
+private:
+	// Key change waiting for the instruction it applies at
+	struct PendingKey
+	{
+		uint8_t key;
+		bool pressed;
+		bool scheduled;
+		uint64_t timestampNS;
+		uint64_t cycle;
+	};
+
+	void Run();
+	bool Execute(const Command& command);
+	// Run count frames standing for the host time between startNS and endNS, returns true when sound was active
+	bool RunFrames(unsigned int count, uint64_t startNS, uint64_t endNS);
+	// Give the keys received since the last call the instruction matching their timestamp among the next cycleCount
+	void ScheduleKeys(uint64_t cycleCount, uint64_t startNS, uint64_t endNS);
+	// Apply every pending key now, before a reset clears the keypad
+	void FlushKeys();
+	void ApplyKey(const PendingKey& pendingKey);
+	void SaveState(unsigned int slot);
+	void LoadState(unsigned int slot);
+	// Restore a savestate, keeping the keys held now, returns false when it was rejected
+	bool RestoreState(const std::vector<uint8_t>& data);
+	std::string GetSaveStatePath(unsigned int slot) const;
+	// Step count recorded frames back, keeping the keys held now
+	void RewindFrames(unsigned int count);
+	void RecordRewindFrame();
+	// Returns false when the ROM failed to reload
+	bool StartRecording();
+	void StopRecording();
+	// Returns false when the ROM failed to reload, a movie that is invalid or of another ROM is reported and not replayed
+	bool StartReplay(const std::vector<uint8_t>& data);
+	void StopReplay();
+	// Run count frames of the movie, the frame it ends in completes with its last keys, returns true when sound was active
+	bool ReplayFrames(unsigned int count);
+	std::string GetMoviePath() const;
+	// Publish the frame runAheadFrames ahead, then restore the present state
+	void PublishRunAheadFrame(bool soundActive);
+	void PublishFrame(bool soundActive);
+
+private:
+	static constexpr size_t COMMAND_CAPACITY = 256;
+
+	// Owned by the emulation thread once started
+	std::unique_ptr<Chip8> chip8;
+	uint64_t frameNumber = 0;
+	uint64_t soundFrames = 0;
+
+	// Ordered by cycle once scheduled, keys received since the last frame follow unscheduled
+	std::vector<PendingKey> pendingKeys;
+	// Last instruction a change of each key was scheduled at and whether it was a press
+	// A press is held for at least a tick, a ROM testing keys once per frame still sees a quick tap
+	uint64_t keyCycles[Chip8::KEY_COUNT] = {};
+	bool keyPressed[Chip8::KEY_COUNT] = {};
+	// Timestamps of the keys applied since the last published frame
+	std::vector<uint64_t> appliedKeys;
+	uint32_t inputLatency[INPUT_LATENCY_BUCKETS] = {};
+
+	unsigned int runAheadFrames = 0;
+	// Present state while the frames ahead run
+	std::unique_ptr<Chip8::State> runAheadState;
+	// Run-ahead cost accumulated since runAheadWindowStartNS, published once a second
+	uint64_t runAheadWindowStartNS = 0;
+	uint64_t runAheadCycles = 0;
+	uint64_t runAheadNS = 0;
+	uint64_t runAheadCyclesPerSecond = 0;
+	uint64_t runAheadNSPerSecond = 0;
+
+	std::string romPath;
+	// As last requested, a movie replays with its own
+	QuirkProfile quirkProfile = QuirkProfile::SuperChip;
+	unsigned int tickCycles = Chip8::DEFAULT_TICK_CYCLES;
+	// Last savestate of each slot for the loaded ROM, empty until saved or read from disk
+	std::vector<uint8_t> saveStates[SAVE_STATE_SLOTS];
+	SaveStateFiles saveStateFiles;
+
+	bool rewindEnabled = true;
+	bool rewinding = false;
+	RewindBuffer rewindBuffer;
+	std::unique_ptr<Chip8::State> rewindState;
+	uint64_t rewindPushNS = 0;
+	uint64_t rewindStepNS = 0;
+
+	Chip8Movie movie;
+	// Waiting for the movie file to be read
+	bool replayRequested = false;
+	bool replaying = false;
+
+	std::thread thread;
+	std::atomic<bool> running = false;
+	std::atomic<bool> failed = false;
+	std::atomic<unsigned int> frameRate = Chip8::TIMER_FREQUENCY;
+	bool jitAvailable = false;
+	bool profilerAvailable = false;
+
+	SpscQueue<Command, COMMAND_CAPACITY> commands;
+	TripleBuffer<Frame> frames;
+};
\ No newline at end of file
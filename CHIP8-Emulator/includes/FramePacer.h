@@ -0,0 +1,32 @@
+#pragma once
+
+#include <cstdint>
+
+// Paces the main loop on an absolute schedule of deadlines, so that waiting late once does not shift later frames.
+// The thread sleeps until shortly before each deadline and only spins for the last fraction of a millisecond,
+// at low rates it only sleeps.
+class FramePacer
+{
+public:
+	explicit FramePacer(unsigned int rate);
+
+	// Frames per second, the schedule restarts from now when it changes
+	void SetRate(unsigned int rate);
+	unsigned int GetRate() const { return rate; }
+
+	// Wait for the next deadline
+	// Returns the number of frame periods elapsed since the previous deadline, more than 1 when the loop fell behind
+	unsigned int WaitForNextFrame();
+
+private:
+	// Sleeping wakes up this long before the deadline, the rest is spun
+	static constexpr uint64_t SPIN_NS = 200'000;
+	// Below this rate a late wake up is a small part of the period, not worth a core spinning, e.g. in the background
+	static constexpr unsigned int MIN_SPIN_RATE = 30;
+	// Further behind than this, the missed frames are dropped and the schedule restarts
+	static constexpr unsigned int MAX_CATCH_UP_FRAMES = 4;
+
+	unsigned int rate = 0;
+	uint64_t periodNS = 0;
+	uint64_t deadlineNS = 0;
+};
\ No newline at end of file
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "Chip8.h"
+
+// History of machine states for rewinding, one entry per frame in an arena allocated once.
+// Every keyframeInterval entries a full copy of the state is stored, the entries in between hold the XOR with the
+// previous state run-length encoded by 8-byte words, so unchanged memory and video cost next to nothing.
+// When the arena or the frame limit is full, the oldest keyframe is dropped with the deltas that depend on it.
+class RewindBuffer
+{
+public:
+	RewindBuffer(size_t arenaBytes, unsigned int maxFrames, unsigned int keyframeInterval);
+
+	void Clear();
+	// Record the state reached at the end of a frame
+	void Push(const Chip8::State& state);
+	// Drop the newest entry and write the state recorded before it to state
+	// Returns false, leaving state alone, when no earlier state is held
+	bool StepBack(Chip8::State& state);
+
+	unsigned int GetFrameCount() const { return count; }
+	size_t GetUsedBytes() const { return usedBytes; }
+	size_t GetArenaBytes() const { return arena.size(); }
+
+private:
+	struct Entry
+	{
+		size_t offset;
+		uint32_t size;
+		// Entries since the last keyframe, 0 for a keyframe
+		uint32_t keyframeDistance;
+	};
+
+	static constexpr size_t STATE_WORDS = sizeof(Chip8::State) / sizeof(uint64_t);
+	static_assert(sizeof(Chip8::State) % sizeof(uint64_t) == 0, "State is encoded by 8-byte words");
+
+	Entry& GetEntry(unsigned int age) { return entries[(first + age) % entries.size()]; }
+	// Encode the XOR of previous and current in scratch, returns its size
+	size_t EncodeDelta(const Chip8::State& previous, const Chip8::State& current);
+	static void ApplyDelta(Chip8::State& state, const uint8_t* delta, size_t size);
+	// Find room for size bytes at writeOffset, evicting the oldest entries in the way
+	void Reserve(size_t size);
+	void EvictOldestGroup();
+
+private:
+	std::vector<uint8_t> arena;
+	// Ring of entries, the oldest at first
+	std::vector<Entry> entries;
+	unsigned int first = 0;
+	unsigned int count = 0;
+	unsigned int keyframeInterval;
+	size_t writeOffset = 0;
+	size_t usedBytes = 0;
+
+	// State of the newest entry, deltas are taken against it and stepping back starts from it
+	Chip8::State newest = {};
+	std::vector<uint8_t> scratch;
+};
\ No newline at end of file
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Reads and writes savestate, movie and profile files on a background thread, callers only queue requests and collect what was read.
+// Writes go to a temporary file renamed over the target, a crash mid-write never leaves a truncated savestate.
+class SaveStateFiles
+{
+public:
+	struct ReadResult
+	{
+		std::string path;
+		std::vector<uint8_t> data;
+	};
+
+	SaveStateFiles();
+	// Finishes the writes already queued
+	~SaveStateFiles();
+
+	void Write(const std::string& path, std::vector<uint8_t> data);
+	void Read(const std::string& path);
+	// Returns false when no read completed since the last call, failed reads are reported and dropped
+	bool PollRead(ReadResult& result);
+
+private:
+	struct Request
+	{
+		bool write;
+		std::string path;
+		std::vector<uint8_t> data;
+	};
+
+	void Run();
+	static bool WriteFile(const std::string& path, const std::vector<uint8_t>& data);
+	static bool ReadFile(const std::string& path, std::vector<uint8_t>& data);
+
+private:
+	std::mutex mutex;
+	std::condition_variable wakeUp;
+	std::deque<Request> requests;
+	std::deque<ReadResult> results;
+	bool stopping = false;
+
+	std::thread thread;
+};
\ No newline at end of file
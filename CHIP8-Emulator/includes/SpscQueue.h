@@ -0,0 +1,47 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <utility>
+
+// Lock-free bounded queue between exactly one producer thread and one consumer thread
+template <typename T, size_t Capacity>
+class SpscQueue
+{
+	static_assert((Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+
+public:
+	// Producer side, returns false and drops the value when the queue is full
+	bool Push(T value)
+	{
+		size_t position = tail.load(std::memory_order_relaxed);
+		if (position - head.load(std::memory_order_acquire) == Capacity)
+		{
+			return false;
+		}
+
+		items[position & (Capacity - 1)] = std::move(value);
+		tail.store(position + 1, std::memory_order_release);
+		return true;
+	}
+
+	// Consumer side, returns false when the queue is empty
+	bool Pop(T& value)
+	{
+		size_t position = head.load(std::memory_order_relaxed);
+		if (position == tail.load(std::memory_order_acquire))
+		{
+			return false;
+		}
+
+		value = std::move(items[position & (Capacity - 1)]);
+		head.store(position + 1, std::memory_order_release);
+		return true;
+	}
+
+private:
+	// Each counter is written by one side only, keep them on separate cache lines
+	alignas(64) std::atomic<size_t> head = 0;
+	alignas(64) std::atomic<size_t> tail = 0;
+	T items[Capacity];
+};
\ No newline at end of file
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+// Lock-free single producer, single consumer triple buffer.
+// The writer fills its back slot and publishes it, the reader takes the latest published slot. Neither side ever
+// waits for the other and the reader never sees a slot being written. Values published between two reads are skipped.
+template <typename T>
+class TripleBuffer
+{
+public:
+	// Writer side: the slot to fill, it stays owned by the writer until Publish
+	T& GetWriteBuffer() { return slots[backIndex].value; }
+	void Publish()
+	{
+		backIndex = middle.exchange(static_cast<uint8_t>(backIndex | FRESH), std::memory_order_acq_rel) & INDEX_MASK;
+	}
+
+	// Reader side: the latest published value, the same as the previous read when nothing new was published
+	// The reference stays valid until the next call
+	const T& Read()
+	{
+		if (middle.load(std::memory_order_relaxed) & FRESH)
+		{
+			frontIndex = middle.exchange(frontIndex, std::memory_order_acq_rel) & INDEX_MASK;
+		}
+		return slots[frontIndex].value;
+	}
+
+private:
+	// Index of the middle slot, plus FRESH when the writer published it since the last read
+	static constexpr uint8_t FRESH = 0x4;
+	static constexpr uint8_t INDEX_MASK = 0x3;
+
+	// Writer and reader touch different slots, keep them on separate cache lines
+	struct alignas(64) Slot
+	{
+		T value = {};
+	};
+	Slot slots[3];
+
+	alignas(64) std::atomic<uint8_t> middle = 1;
+	alignas(64) uint8_t backIndex = 0;
+	alignas(64) uint8_t frontIndex = 2;
+};
\ No newline at end of file
@@ -1,15 +1,59 @@
 #pragma once
 
+#include <cstring>
 #include <random>
 #include <string>
 #include <unordered_map>
+#include <vector>
 
 #include <SDL3/SDL.h>
 #include <utils/glad.h>
 
+#include "Chip8CallGraph.h"
+#include "Chip8Profiler.h"
+
 struct EmulatorConfig
 {
-    int emulationCycles = 5;
+    // Instructions per 60 Hz frame, timers tick once per frame whatever the rate
+    int emulationCycles = 11;
+    bool superinstructions = true;
+    bool jit = false;
+    // Frames emulated ahead of the one shown, 0 to disable run-ahead
+    int runAheadFrames = 0;
+    // Record frames so that holding Backspace steps back through them
+    bool rewind = true;
+    // Index in the QuirkProfile enum, the ROM is reloaded when it changes
+    int quirkProfile = 1;
+    // Index in Window::PALETTES
+    int palette = 0;
+    bool showInputLatency = false;
+    // Count instructions per opcode class and address, shown under the registers
+    bool profiler = false;
+    // Follow guest calls and returns, shown with the profile
+    bool callGraph = false;
+};
+
+// CHIP-8 key pressed or released
+struct KeyEvent
+{
+    uint8_t key;
+    bool pressed;
+    // When SDL received it, on the SDL_GetTicksNS clock
+    uint64_t timestampNS;
+};
+
+// Quick-save or quick-load of a savestate slot
+struct SaveStateEvent
+{
+    unsigned int slot;
+    bool save;
+};
+
+// Start or stop recording or replaying the movie of the ROM
+enum class MovieEvent
+{
+    ToggleRecording,
+    ToggleReplay
 };
 
 class Window
@@ -18,9 +62,16 @@ public:
     Window(const std::string& title, int width, int height, int textureWidth, int textureHeight);
     ~Window();
 
-    void Update(const void* buffer);
-    bool ProcessInput(uint8_t* keys);
+    // Display rows are 64-bit words, bit 63 being the leftmost pixel
+    void Update(const uint64_t* display);
+    // Returns false when the window is closed, CHIP-8 key changes are appended to keyEvents in order
+    // F1 to F4 select the savestate slot, F5 saves to it and F9 loads it
+    // Backspace rewinds while held, see IsRewindHeld, F7 records a movie and F8 replays it
+    bool ProcessInput(std::vector<KeyEvent>& keyEvents, std::vector<SaveStateEvent>& saveStateEvents, std::vector<MovieEvent>& movieEvents);
     void PlaySound();
+    // Minimised, hidden, covered or without keyboard focus
+    bool IsInBackground() const;
+    bool IsRewindHeld() const { return rewindHeld; }
 
     bool HasChangedROM() const { return currentROMIndex != ROMIndexRequested; }
     void UpdateCurrentROMIndex() { currentROMIndex = ROMIndexRequested; }
@@ -28,17 +79,77 @@ public:
     const std::string& GetFirstFoundROM() const;
     const std::string& GetCurrentROMToLoad() const { return ROMS[currentROMIndex]; }
     
-	void SetRegistersToDisplay(uint8_t* registers) { registersToDisplay = registers; }
+	// Copied, the editor shows them until the next call
+	void SetRegistersToDisplay(const uint8_t* registers)
+	{
+		memcpy(registersToDisplay, registers, sizeof(registersToDisplay));
+		hasRegistersToDisplay = true;
+	}
+    // Key events per latency bucket, plotted while config.showInputLatency is set
+    void SetInputLatencyToDisplay(const uint32_t* histogram, int bucketCount, float bucketMS);
+    // Instructions emulated ahead and time spent on it per second, shown while run-ahead is on
+    void SetRunAheadCostToDisplay(uint64_t cyclesPerSecond, uint64_t nsPerSecond)
+    {
+        runAheadCyclesPerSecond = cyclesPerSecond;
+        runAheadNSPerSecond = nsPerSecond;
+    }
+    // Rewind history held and the cost of recording and stepping back a frame, shown while rewind is on
+    void SetRewindStatsToDisplay(unsigned int frames, size_t bytes, uint64_t pushNS, uint64_t stepNS)
+    {
+        rewindFrames = frames;
+        rewindBytes = bytes;
+        rewindPushNS = pushNS;
+        rewindStepNS = stepNS;
+    }
+    // Copied, nullptr when not profiling
+    void SetProfileToDisplay(const Chip8Profiler::Summary* summary)
+    {
+        hasProfileToDisplay = summary != nullptr;
+        if (summary)
+        {
+            profileToDisplay = *summary;
+        }
+    }
+    // Copied, nullptr when not following calls
+    void SetCallGraphToDisplay(const Chip8CallGraph::Summary* summary)
+    {
+        hasCallGraphToDisplay = summary != nullptr;
+        if (summary)
+        {
+            callGraphToDisplay = *summary;
+        }
+    }
+    // Profiler and call graph buttons pressed since the last call
+    void TakeProfilerRequests(bool& reset, bool& exportCSV)
+    {
+        reset = profileResetRequested;
+        exportCSV = profileExportRequested;
+        profileResetRequested = false;
+        profileExportRequested = false;
+    }
+    void SetMovieStatusToDisplay(bool recording, bool replaying)
+    {
+        recordingMovie = recording;
+        replayingMovie = replaying;
+    }
 
     EmulatorConfig config;
 
 private:
     void InitAudio();
 
+    // Display
+    void InitDisplay();
+    GLuint CompileShader(GLenum type, const char* source);
+    void RenderDisplay(const uint64_t* display);
+
     // Editor
     void SetupDockingSpace();
 	void DisplayEditor();
     void DisplayRegisters();
+    void DisplayInputLatency();
+    void DisplayProfiler();
+    void DisplayCallGraph();
 
 private:
     // Window display
@@ -54,9 +165,24 @@ private:
     static constexpr int SAMPLE_COUNT = SAMPLE_RATE * (DURATION_MS * 0.001);
     static constexpr float FREQUENCY = 500;
 
+    // Render texture shown by ImGui, filled from the packed display by a shader
     GLuint texture;
     int textureWidth;
     int textureHeight;
+    GLuint displayTexture;
+    GLuint framebuffer;
+    GLuint displayProgram;
+    GLuint vertexArray;
+    GLint paletteLocation = -1;
+
+    struct Palette
+    {
+        const char* name;
+        // Off and on pixel colours
+        float colors[2][4];
+    };
+    static constexpr int PALETTE_COUNT = 4;
+    static const Palette PALETTES[PALETTE_COUNT];
 
     static constexpr const char* ROMSFolder = "roms/";
     static const std::string INVALID_ROM;
@@ -64,8 +190,29 @@ private:
     int currentROMIndex = 0;
     int ROMIndexRequested = 0;
 
-    // Display data pointers
-	uint8_t* registersToDisplay = nullptr;
+    static constexpr unsigned int SAVE_STATE_SLOTS = 4;
+    unsigned int saveStateSlot = 0;
+    bool rewindHeld = false;
+
+    // Display data
+	uint8_t registersToDisplay[16] = {};
+	bool hasRegistersToDisplay = false;
+    std::vector<float> inputLatencyToDisplay;
+    float inputLatencyBucketMS = 1.0f;
+    uint64_t runAheadCyclesPerSecond = 0;
+    uint64_t runAheadNSPerSecond = 0;
+    unsigned int rewindFrames = 0;
+    size_t rewindBytes = 0;
+    uint64_t rewindPushNS = 0;
+    uint64_t rewindStepNS = 0;
+    bool recordingMovie = false;
+    bool replayingMovie = false;
+    Chip8Profiler::Summary profileToDisplay = {};
+    bool hasProfileToDisplay = false;
+    Chip8CallGraph::Summary callGraphToDisplay = {};
+    bool hasCallGraphToDisplay = false;
+    bool profileResetRequested = false;
+    bool profileExportRequested = false;
 
     const std::unordered_map<SDL_Keycode, uint8_t> keymap =
     {
@@ -0,0 +1,720 @@
+#include "EmulationThread.h"
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <sstream>
+
+#include <SDL3/SDL.h>
+
+#include "FramePacer.h"
+
+EmulationThread::Command EmulationThread::Command::Key(uint8_t key, bool pressed, uint64_t timestampNS)
+{
+	Command command;
+	command.type = Type::Key;
+	command.key = key;
+	command.pressed = pressed;
+	command.timestampNS = timestampNS;
+	return command;
+}
+
+EmulationThread::Command EmulationThread::Command::LoadROM(const std::string& romPath, QuirkProfile profile)
+{
+	Command command;
+	command.type = Type::LoadROM;
+	command.romPath = romPath;
+	command.profile = profile;
+	return command;
+}
+
+EmulationThread::Command EmulationThread::Command::Configure(unsigned int tickCycles, bool fusion, bool jit, unsigned int runAheadFrames,
+	bool rewind)
+{
+	Command command;
+	command.type = Type::Configure;
+	command.tickCycles = tickCycles;
+	command.fusion = fusion;
+	command.jit = jit;
+	command.runAheadFrames = runAheadFrames;
+	command.rewind = rewind;
+	return command;
+}
+
+EmulationThread::Command EmulationThread::Command::SaveState(unsigned int slot)
+{
+	Command command;
+	command.type = Type::SaveState;
+	command.slot = slot;
+	return command;
+}
+
+EmulationThread::Command EmulationThread::Command::LoadState(unsigned int slot)
+{
+	Command command;
+	command.type = Type::LoadState;
+	command.slot = slot;
+	return command;
+}
+
+EmulationThread::Command EmulationThread::Command::Rewind(bool held)
+{
+	Command command;
+	command.type = Type::Rewind;
+	command.pressed = held;
+	return command;
+}
+
+EmulationThread::Command EmulationThread::Command::RecordMovie()
+{
+	Command command;
+	command.type = Type::RecordMovie;
+	return command;
+}
+
+EmulationThread::Command EmulationThread::Command::ReplayMovie()
+{
+	Command command;
+	command.type = Type::ReplayMovie;
+	return command;
+}
+
+EmulationThread::Command EmulationThread::Command::Profile(bool enabled)
+{
+	Command command;
+	command.type = Type::Profile;
+	command.pressed = enabled;
+	return command;
+}
+
+EmulationThread::Command EmulationThread::Command::CallGraph(bool enabled)
+{
+	Command command;
+	command.type = Type::CallGraph;
+	command.pressed = enabled;
+	return command;
+}
+
+EmulationThread::Command EmulationThread::Command::ResetProfile()
+{
+	Command command;
+	command.type = Type::ResetProfile;
+	return command;
+}
+
+EmulationThread::Command EmulationThread::Command::ExportProfile()
+{
+	Command command;
+	command.type = Type::ExportProfile;
+	return command;
+}
+
+EmulationThread::EmulationThread()
+	: chip8(std::make_unique<Chip8>()), runAheadState(std::make_unique<Chip8::State>()),
+	  rewindBuffer(REWIND_ARENA_BYTES, REWIND_FRAMES, REWIND_KEYFRAME_INTERVAL), rewindState(std::make_unique<Chip8::State>())
+{
+	// Probe the JIT once so the GUI can grey it out instead of asking for it
+	jitAvailable = chip8->SetJITEnabled(true);
+	chip8->SetJITEnabled(false);
+	profilerAvailable = chip8->SetProfilerEnabled(true);
+	chip8->SetProfilerEnabled(false);
+
+	pendingKeys.reserve(COMMAND_CAPACITY);
+	appliedKeys.reserve(COMMAND_CAPACITY);
+}
+
+EmulationThread::~EmulationThread()
+{
+	Stop();
+}
+
+bool EmulationThread::Start(const std::string& romPath, QuirkProfile profile)
+{
+	if (running.load() || !Execute(Command::LoadROM(romPath, profile)))
+	{
+		return false;
+	}
+
+	PublishFrame(false);
+	running.store(true);
+	thread = std::thread(&EmulationThread::Run, this);
+	return true;
+}
+
+void EmulationThread::Stop()
+{
+	running.store(false);
+	if (thread.joinable())
+	{
+		thread.join();
+	}
+
+	// A movie still recording is written on exit
+	StopRecording();
+}
+
+void EmulationThread::Run()
+{
+	FramePacer pacer(frameRate.load(std::memory_order_relaxed));
+	uint64_t windowStartNS = SDL_GetTicksNS();
+	while (running.load(std::memory_order_relaxed))
+	{
+		pacer.SetRate(frameRate.load(std::memory_order_relaxed));
+		unsigned int elapsed = pacer.WaitForNextFrame();
+
+		// Commands sent during the wait apply before the frame runs
+		Command command;
+		while (commands.Pop(command))
+		{
+			if (!Execute(command))
+			{
+				failed.store(true, std::memory_order_release);
+				return;
+			}
+		}
+
+		// Savestates of earlier sessions arrive once read from disk
+		SaveStateFiles::ReadResult readResult;
+		while (saveStateFiles.PollRead(readResult))
+		{
+			if (readResult.path == GetMoviePath())
+			{
+				if (replayRequested && !StartReplay(readResult.data))
+				{
+					failed.store(true, std::memory_order_release);
+					return;
+				}
+				continue;
+			}
+
+			for (unsigned int slot = 0; slot < SAVE_STATE_SLOTS; ++slot)
+			{
+				// Ignored when the slot was saved again while reading
+				if (readResult.path == GetSaveStatePath(slot) && saveStates[slot].empty())
+				{
+					if (RestoreState(readResult.data))
+					{
+						saveStates[slot] = std::move(readResult.data);
+					}
+					break;
+				}
+			}
+		}
+
+		// Catch up on the frames the pacer missed, only the last one is published
+		uint64_t windowEndNS = SDL_GetTicksNS();
+		bool soundActive = false;
+		if (rewinding)
+		{
+			RewindFrames(elapsed);
+		}
+		else
+		{
+			soundActive = replaying ? ReplayFrames(elapsed) : RunFrames(elapsed, windowStartNS, windowEndNS);
+			if (rewindEnabled)
+			{
+				RecordRewindFrame();
+			}
+		}
+		windowStartNS = windowEndNS;
+		if (runAheadFrames > 0 && !rewinding)
+		{
+			PublishRunAheadFrame(soundActive);
+		}
+		else
+		{
+			PublishFrame(soundActive);
+		}
+	}
+}
+
+bool EmulationThread::RunFrames(unsigned int count, uint64_t startNS, uint64_t endNS)
+{
+	uint64_t cycleCount = chip8->GetCyclesToTick() + static_cast<uint64_t>(count - 1) * chip8->GetTickCycles();
+	ScheduleKeys(cycleCount, startNS, endNS);
+
+	bool soundActive = false;
+	size_t applied = 0;
+	for (unsigned int i = 0; i < count; ++i)
+	{
+		// Split the frame at every key change falling inside it
+		uint64_t tickCycle = chip8->GetCycleCount() + chip8->GetCyclesToTick();
+		while (applied < pendingKeys.size() && pendingKeys[applied].cycle < tickCycle)
+		{
+			const PendingKey& pendingKey = pendingKeys[applied++];
+			if (pendingKey.cycle > chip8->GetCycleCount())
+			{
+				soundActive |= chip8->RunCycles(static_cast<unsigned int>(pendingKey.cycle - chip8->GetCycleCount())).soundActive;
+			}
+			ApplyKey(pendingKey);
+		}
+		soundActive |= chip8->RunFrame().soundActive;
+	}
+
+	// Releases held back for a quick tap stay for the next frames
+	pendingKeys.erase(pendingKeys.begin(), pendingKeys.begin() + applied);
+	return soundActive;
+}
+
+void EmulationThread::ScheduleKeys(uint64_t cycleCount, uint64_t startNS, uint64_t endNS)
+{
+	uint64_t firstCycle = chip8->GetCycleCount();
+	uint64_t spanNS = endNS > startNS ? endNS - startNS : 1;
+	for (PendingKey& pendingKey : pendingKeys)
+	{
+		if (pendingKey.scheduled)
+		{
+			continue;
+		}
+
+		// Events older than the window, sent late by the GUI thread, apply at its start
+		uint64_t offsetNS = pendingKey.timestampNS > startNS ? std::min(pendingKey.timestampNS - startNS, spanNS - 1) : 0;
+		uint64_t cycle = firstCycle + offsetNS * cycleCount / spanNS;
+
+		// Never before an earlier change of the same key, and a release not before the press was held for a tick
+		uint8_t key = pendingKey.key;
+		uint64_t earliest = keyCycles[key] + (keyPressed[key] && !pendingKey.pressed ? chip8->GetTickCycles() : 0);
+		pendingKey.cycle = std::max(cycle, earliest);
+		pendingKey.scheduled = true;
+		keyCycles[key] = pendingKey.cycle;
+		keyPressed[key] = pendingKey.pressed;
+	}
+
+	// Stable, changes of one key keep their order
+	std::stable_sort(pendingKeys.begin(), pendingKeys.end(),
+		[](const PendingKey& a, const PendingKey& b) { return a.cycle < b.cycle; });
+}
+
+void EmulationThread::FlushKeys()
+{
+	for (const PendingKey& pendingKey : pendingKeys)
+	{
+		ApplyKey(pendingKey);
+	}
+	pendingKeys.clear();
+
+	for (unsigned int key = 0; key < Chip8::KEY_COUNT; ++key)
+	{
+		keyCycles[key] = chip8->GetCycleCount();
+		keyPressed[key] = false;
+	}
+}
+
+void EmulationThread::ApplyKey(const PendingKey& pendingKey)
+{
+	chip8->GetKeypad()[pendingKey.key] = pendingKey.pressed ? 1 : 0;
+	movie.Record(*chip8);
+	appliedKeys.push_back(pendingKey.timestampNS);
+}
+
+bool EmulationThread::Execute(const Command& command)
+{
+	switch (command.type)
+	{
+	case Command::Type::Key:
+		// Applied by the next frame at the instruction matching its timestamp, the movie drives the keypad while replaying
+		if (!replaying)
+		{
+			pendingKeys.push_back({ static_cast<uint8_t>(command.key & (Chip8::KEY_COUNT - 1)), command.pressed, false, command.timestampNS, 0 });
+		}
+		break;
+	case Command::Type::LoadROM:
+	{
+		// The movie of the previous run ends with it
+		StopRecording();
+		StopReplay();
+
+		// Keys sent before the reset apply before it
+		FlushKeys();
+		quirkProfile = command.profile;
+		chip8->SetQuirkProfile(command.profile);
+		bool loaded = chip8->LoadROM(command.romPath);
+		FlushKeys();
+
+		// History and savestates in memory belong to the previous run
+		rewindBuffer.Clear();
+		if (romPath != command.romPath)
+		{
+			romPath = command.romPath;
+			for (std::vector<uint8_t>& saveState : saveStates)
+			{
+				saveState.clear();
+			}
+		}
+		return loaded;
+	}
+	case Command::Type::SaveState:
+		SaveState(command.slot);
+		break;
+	case Command::Type::LoadState:
+		LoadState(command.slot);
+		break;
+	case Command::Type::Rewind:
+		rewinding = command.pressed && rewindEnabled;
+		if (rewinding)
+		{
+			// Playing on from an earlier frame, a recording is cut back to it instead
+			StopReplay();
+		}
+		break;
+	case Command::Type::RecordMovie:
+		if (movie.IsRecording())
+		{
+			StopRecording();
+			break;
+		}
+		return StartRecording();
+	case Command::Type::ReplayMovie:
+		if (replaying || replayRequested)
+		{
+			StopReplay();
+			break;
+		}
+		// Replayed once the file is read
+		StopRecording();
+		replayRequested = true;
+		saveStateFiles.Read(GetMoviePath());
+		break;
+	case Command::Type::Profile:
+		chip8->SetProfilerEnabled(command.pressed && profilerAvailable);
+		break;
+	case Command::Type::CallGraph:
+		chip8->SetCallGraphEnabled(command.pressed && profilerAvailable);
+		break;
+	case Command::Type::ResetProfile:
+		chip8->ResetProfiler();
+		break;
+	case Command::Type::ExportProfile:
+		if (chip8->GetProfiler())
+		{
+			std::ostringstream csv;
+			chip8->GetProfiler()->WriteCSV(csv);
+			std::string text = csv.str();
+			saveStateFiles.Write(PROFILE_FOLDER + std::filesystem::path(romPath).stem().string() + ".csv",
+				std::vector<uint8_t>(text.begin(), text.end()));
+		}
+		if (chip8->GetCallGraph())
+		{
+			std::string name = std::filesystem::path(romPath).stem().string();
+			std::ostringstream folded;
+			chip8->GetCallGraph()->WriteFolded(folded, name, chip8->GetCycleCount());
+			std::string text = folded.str();
+			saveStateFiles.Write(PROFILE_FOLDER + name + ".folded", std::vector<uint8_t>(text.begin(), text.end()));
+		}
+		break;
+	case Command::Type::Configure:
+		if (tickCycles != command.tickCycles)
+		{
+			// A movie runs at a single speed from start to end
+			tickCycles = command.tickCycles;
+			StopRecording();
+			StopReplay();
+		}
+		if (!replaying && chip8->GetTickCycles() != tickCycles)
+		{
+			chip8->SetTickCycles(tickCycles);
+		}
+		if (chip8->IsFusionEnabled() != command.fusion)
+		{
+			chip8->SetFusionEnabled(command.fusion);
+		}
+		if (chip8->IsJITEnabled() != command.jit)
+		{
+			chip8->SetJITEnabled(command.jit && jitAvailable);
+		}
+		if (runAheadFrames != std::min(command.runAheadFrames, MAX_RUN_AHEAD_FRAMES))
+		{
+			// The cost is measured again from scratch
+			runAheadFrames = std::min(command.runAheadFrames, MAX_RUN_AHEAD_FRAMES);
+			runAheadWindowStartNS = 0;
+			runAheadCycles = 0;
+			runAheadNS = 0;
+			runAheadCyclesPerSecond = 0;
+			runAheadNSPerSecond = 0;
+		}
+		if (rewindEnabled != command.rewind)
+		{
+			rewindEnabled = command.rewind;
+			rewinding = false;
+			rewindBuffer.Clear();
+		}
+		break;
+	}
+	return true;
+}
+
+void EmulationThread::SaveState(unsigned int slot)
+{
+	if (slot >= SAVE_STATE_SLOTS)
+	{
+		std::cerr << "Invalid savestate slot: " << slot << std::endl;
+		return;
+	}
+
+	// Serialising takes well under a microsecond, only the copy handed to the writer allocates
+	saveStates[slot].resize(Chip8::SAVE_STATE_SIZE);
+	chip8->SaveState(saveStates[slot].data());
+	saveStateFiles.Write(GetSaveStatePath(slot), saveStates[slot]);
+}
+
+void EmulationThread::LoadState(unsigned int slot)
+{
+	if (slot >= SAVE_STATE_SLOTS)
+	{
+		std::cerr << "Invalid savestate slot: " << slot << std::endl;
+		return;
+	}
+
+	if (saveStates[slot].empty())
+	{
+		// Not saved this session, restored once the file is read
+		saveStateFiles.Read(GetSaveStatePath(slot));
+		return;
+	}
+	RestoreState(saveStates[slot]);
+}
+
+bool EmulationThread::RestoreState(const std::vector<uint8_t>& data)
+{
+	// A savestate comes from another run than the movie
+	StopRecording();
+	StopReplay();
+
+	// Keys changed before the load apply before it, the keys held now stay held after it
+	FlushKeys();
+	uint8_t keypad[Chip8::KEY_COUNT];
+	memcpy(keypad, chip8->GetKeypad(), sizeof(keypad));
+
+	if (!chip8->LoadState(data.data(), data.size()))
+	{
+		return false;
+	}
+
+	memcpy(chip8->GetKeypad(), keypad, sizeof(keypad));
+	FlushKeys();
+	return true;
+}
+
+std::string EmulationThread::GetSaveStatePath(unsigned int slot) const
+{
+	return SAVE_STATE_FOLDER + std::filesystem::path(romPath).stem().string() + "." + std::to_string(slot + 1) + ".state";
+}
+
+void EmulationThread::RewindFrames(unsigned int count)
+{
+	uint64_t startNS = SDL_GetTicksNS();
+	unsigned int stepped = 0;
+	while (stepped < count && rewindBuffer.StepBack(*rewindState))
+	{
+		++stepped;
+	}
+	if (stepped == 0)
+	{
+		// Oldest frame held reached
+		return;
+	}
+
+	// Keys changed before the step apply before it, the keys held now stay held after it
+	FlushKeys();
+	memcpy(rewindState->keypad, chip8->GetKeypad(), sizeof(rewindState->keypad));
+	chip8->SetState(*rewindState);
+	FlushKeys();
+	movie.Truncate(*chip8);
+
+	// Moving average over the last few dozen steps
+	uint64_t stepNS = (SDL_GetTicksNS() - startNS) / stepped;
+	rewindStepNS = rewindStepNS == 0 ? stepNS : (rewindStepNS * 15 + stepNS) / 16;
+}
+
+void EmulationThread::RecordRewindFrame()
+{
+	uint64_t startNS = SDL_GetTicksNS();
+	rewindBuffer.Push(chip8->GetState());
+	uint64_t pushNS = SDL_GetTicksNS() - startNS;
+	// Moving average over the last few dozen frames
+	rewindPushNS = rewindPushNS == 0 ? pushNS : (rewindPushNS * 15 + pushNS) / 16;
+}
+
+bool EmulationThread::StartRecording()
+{
+	StopReplay();
+
+	// A movie starts from a reset with a seed of its own, keys sent before it apply before the reset
+	FlushKeys();
+	if (!chip8->LoadROM(romPath))
+	{
+		return false;
+	}
+	FlushKeys();
+	rewindBuffer.Clear();
+
+	uint32_t seed = static_cast<uint32_t>(SDL_GetTicksNS());
+	chip8->SetRandomSeed(seed);
+	movie.StartRecording(*chip8, seed);
+	return true;
+}
+
+void EmulationThread::StopRecording()
+{
+	if (!movie.IsRecording())
+	{
+		return;
+	}
+
+	movie.StopRecording(*chip8);
+	std::vector<uint8_t> data;
+	movie.Serialize(data);
+	saveStateFiles.Write(GetMoviePath(), std::move(data));
+}
+
+bool EmulationThread::StartReplay(const std::vector<uint8_t>& data)
+{
+	replayRequested = false;
+	if (!movie.Deserialize(data.data(), data.size()))
+	{
+		return true;
+	}
+
+	// Keys sent before the reset apply before it, the movie then drives the keypad
+	FlushKeys();
+	chip8->SetQuirkProfile(movie.GetQuirkProfile());
+	if (!chip8->LoadROM(romPath))
+	{
+		return false;
+	}
+	FlushKeys();
+	rewindBuffer.Clear();
+
+	replaying = movie.StartReplay(*chip8);
+	if (!replaying && chip8->GetQuirkProfile() != quirkProfile)
+	{
+		// Recorded with another ROM, play it from the reset instead
+		chip8->SetQuirkProfile(quirkProfile);
+	}
+	return true;
+}
+
+void EmulationThread::StopReplay()
+{
+	replayRequested = false;
+	if (!replaying)
+	{
+		return;
+	}
+
+	// Playing on from where the replay stopped, with the settings of the GUI
+	replaying = false;
+	if (chip8->GetQuirkProfile() != quirkProfile)
+	{
+		chip8->SetQuirkProfile(quirkProfile);
+	}
+	if (chip8->GetTickCycles() != tickCycles)
+	{
+		chip8->SetTickCycles(tickCycles);
+	}
+	FlushKeys();
+}
+
+bool EmulationThread::ReplayFrames(unsigned int count)
+{
+	bool soundActive = false;
+	for (unsigned int i = 0; i < count && replaying; ++i)
+	{
+		soundActive |= movie.Replay(*chip8, chip8->GetCyclesToTick()).soundActive;
+		if (movie.IsReplayFinished(*chip8))
+		{
+			if (!movie.IsInSync(*chip8))
+			{
+				std::cerr << "Movie replay desynced from the recording: " << GetMoviePath() << std::endl;
+			}
+
+			// The rest of the frame runs with the last keys of the movie
+			if (chip8->GetCyclesToTick() != chip8->GetTickCycles())
+			{
+				soundActive |= chip8->RunCycles(chip8->GetCyclesToTick()).soundActive;
+			}
+			StopReplay();
+		}
+	}
+	return soundActive;
+}
+
+std::string EmulationThread::GetMoviePath() const
+{
+	return MOVIE_FOLDER + std::filesystem::path(romPath).stem().string() + ".c8m";
+}
+
+void EmulationThread::PublishRunAheadFrame(bool soundActive)
+{
+	uint64_t startNS = SDL_GetTicksNS();
+	if (runAheadWindowStartNS == 0)
+	{
+		runAheadWindowStartNS = startNS;
+	}
+
+	// Only memory written ahead is decoded again on restore, a snapshot is otherwise a plain copy
+	*runAheadState = chip8->GetState();
+	for (unsigned int i = 0; i < runAheadFrames; ++i)
+	{
+		runAheadCycles += chip8->RunFrame().cycles;
+	}
+	// Sound follows the present, the future frames would beep early and again once reached
+	PublishFrame(soundActive);
+	chip8->SetState(*runAheadState);
+
+	uint64_t endNS = SDL_GetTicksNS();
+	runAheadNS += endNS - startNS;
+	if (endNS - runAheadWindowStartNS >= 1'000'000'000)
+	{
+		uint64_t windowNS = endNS - runAheadWindowStartNS;
+		runAheadCyclesPerSecond = runAheadCycles * 1'000'000'000 / windowNS;
+		runAheadNSPerSecond = runAheadNS * 1'000'000'000 / windowNS;
+		runAheadWindowStartNS = endNS;
+		runAheadCycles = 0;
+		runAheadNS = 0;
+	}
+}
+
+void EmulationThread::PublishFrame(bool soundActive)
+{
+	if (soundActive)
+	{
+		++soundFrames;
+	}
+
+	Frame& frame = frames.GetWriteBuffer();
+	memcpy(frame.video, chip8->GetVideo(), sizeof(frame.video));
+	memcpy(frame.registers, chip8->GetRegisters(), sizeof(frame.registers));
+	frame.frameNumber = frameNumber++;
+	frame.soundFrames = soundFrames;
+
+	uint64_t nowNS = SDL_GetTicksNS();
+	for (uint64_t timestampNS : appliedKeys)
+	{
+		uint64_t latencyNS = nowNS > timestampNS ? nowNS - timestampNS : 0;
+		++inputLatency[std::min<uint64_t>(latencyNS / INPUT_LATENCY_BUCKET_NS, INPUT_LATENCY_BUCKETS - 1)];
+	}
+	appliedKeys.clear();
+	memcpy(frame.inputLatency, inputLatency, sizeof(frame.inputLatency));
+	frame.runAheadCyclesPerSecond = runAheadFrames > 0 ? runAheadCyclesPerSecond : 0;
+	frame.runAheadNSPerSecond = runAheadFrames > 0 ? runAheadNSPerSecond : 0;
+	frame.rewindFrames = rewindBuffer.GetFrameCount();
+	frame.rewindBytes = rewindBuffer.GetUsedBytes();
+	frame.rewindPushNS = rewindPushNS;
+	frame.rewindStepNS = rewindStepNS;
+	frame.recordingMovie = movie.IsRecording();
+	frame.replayingMovie = replaying;
+	frame.profiling = chip8->GetProfiler() != nullptr;
+	if (frame.profiling)
+	{
+		chip8->GetProfiler()->Summarize(frame.profile);
+	}
+	frame.callGraphing = chip8->GetCallGraph() != nullptr;
+	if (frame.callGraphing)
+	{
+		chip8->GetCallGraph()->Summarize(frame.callGraph, chip8->GetCycleCount());
+	}
+
+	frames.Publish();
+}
\ No newline at end of file
@@ -0,0 +1,48 @@
+#include "FramePacer.h"
+
+#include <SDL3/SDL.h>
+
+FramePacer::FramePacer(unsigned int rate)
+{
+	SetRate(rate);
+}
+
+void FramePacer::SetRate(unsigned int newRate)
+{
+	if (newRate == 0 || newRate == rate)
+	{
+		return;
+	}
+
+	rate = newRate;
+	periodNS = SDL_NS_PER_SECOND / rate;
+	deadlineNS = SDL_GetTicksNS() + periodNS;
+}
+
+unsigned int FramePacer::WaitForNextFrame()
+{
+	// Sleep while more than the spin is left, then spin for the rest
+	// A wake up later than the spin is not made up here, the next deadline does not move
+	uint64_t spinNS = rate >= MIN_SPIN_RATE ? SPIN_NS : 0;
+	uint64_t now = SDL_GetTicksNS();
+	while (now < deadlineNS)
+	{
+		if (deadlineNS - now > spinNS)
+		{
+			SDL_DelayNS(deadlineNS - now - spinNS);
+		}
+		now = SDL_GetTicksNS();
+	}
+
+	uint64_t frames = 1 + (now - deadlineNS) / periodNS;
+	if (frames > MAX_CATCH_UP_FRAMES)
+	{
+		// Stalled, e.g. while the window was dragged: run one frame and restart the schedule rather than racing
+		deadlineNS = now + periodNS;
+		return 1;
+	}
+
+	// Next deadline is relative to the previous one, not to now, so lateness does not accumulate
+	deadlineNS += frames * periodNS;
+	return static_cast<unsigned int>(frames);
+}
\ No newline at end of file
@@ -0,0 +1,219 @@
+#include "RewindBuffer.h"
+
+#include <algorithm>
+#include <cstring>
+
+// Delta runs: a header of two 16-bit counts, unchanged words to skip then changed words stored XORed
+static constexpr size_t RUN_HEADER_BYTES = 2 * sizeof(uint16_t);
+static constexpr size_t MAX_RUN_WORDS = UINT16_MAX;
+
+RewindBuffer::RewindBuffer(size_t arenaBytes, unsigned int maxFrames, unsigned int keyframeInterval)
+	: arena(std::max(arenaBytes, 2 * sizeof(Chip8::State))), entries(std::max(maxFrames, 2U)),
+	  keyframeInterval(std::max(keyframeInterval, 1U)),
+	  // Worst case of a delta, every word changed and a run header for every other word
+	  scratch((STATE_WORDS / 2 + 1) * RUN_HEADER_BYTES + sizeof(Chip8::State))
+{
+}
+
+void RewindBuffer::Clear()
+{
+	first = 0;
+	count = 0;
+	writeOffset = 0;
+	usedBytes = 0;
+}
+
+void RewindBuffer::Push(const Chip8::State& state)
+{
+	if (count == entries.size())
+	{
+		EvictOldestGroup();
+	}
+
+	// A delta needs the keyframe it builds on, it is given up when it would not be smaller than a copy
+	bool keyframe = count == 0 || GetEntry(count - 1).keyframeDistance + 1 >= keyframeInterval;
+	size_t size = keyframe ? sizeof(Chip8::State) : EncodeDelta(newest, state);
+	if (!keyframe && size >= sizeof(Chip8::State))
+	{
+		keyframe = true;
+		size = sizeof(Chip8::State);
+	}
+
+	Reserve(size);
+	if (!keyframe && count == 0)
+	{
+		// Making room dropped the keyframe the delta was based on
+		keyframe = true;
+		size = sizeof(Chip8::State);
+		Reserve(size);
+	}
+
+	unsigned int keyframeDistance = keyframe ? 0 : GetEntry(count - 1).keyframeDistance + 1;
+	memcpy(arena.data() + writeOffset, keyframe ? reinterpret_cast<const uint8_t*>(&state) : scratch.data(), size);
+	++count;
+	GetEntry(count - 1) = { writeOffset, static_cast<uint32_t>(size), keyframeDistance };
+
+	writeOffset += size;
+	usedBytes += size;
+	newest = state;
+}
+
+bool RewindBuffer::StepBack(Chip8::State& state)
+{
+	if (count < 2)
+	{
+		return false;
+	}
+
+	Entry dropped = GetEntry(count - 1);
+	--count;
+	writeOffset = dropped.offset;
+	usedBytes -= dropped.size;
+
+	if (dropped.keyframeDistance > 0)
+	{
+		// XOR is its own inverse, the delta that led to the dropped state leads back from it
+		ApplyDelta(newest, arena.data() + dropped.offset, dropped.size);
+	}
+	else
+	{
+		// Rebuild from the previous keyframe, at most keyframeInterval deltas
+		unsigned int last = count - 1;
+		unsigned int keyframe = last - GetEntry(last).keyframeDistance;
+		memcpy(&newest, arena.data() + GetEntry(keyframe).offset, sizeof(Chip8::State));
+		for (unsigned int age = keyframe + 1; age <= last; ++age)
+		{
+			const Entry& entry = GetEntry(age);
+			ApplyDelta(newest, arena.data() + entry.offset, entry.size);
+		}
+	}
+
+	state = newest;
+	return true;
+}
+
+size_t RewindBuffer::EncodeDelta(const Chip8::State& previous, const Chip8::State& current)
+{
+	const uint8_t* a = reinterpret_cast<const uint8_t*>(&previous);
+	const uint8_t* b = reinterpret_cast<const uint8_t*>(&current);
+	uint8_t* out = scratch.data();
+
+	size_t word = 0;
+	while (word < STATE_WORDS)
+	{
+		uint64_t x = 0;
+		uint64_t y = 0;
+
+		size_t skip = 0;
+		while (word < STATE_WORDS && skip < MAX_RUN_WORDS)
+		{
+			memcpy(&x, a + word * sizeof(uint64_t), sizeof(x));
+			memcpy(&y, b + word * sizeof(uint64_t), sizeof(y));
+			if (x != y)
+			{
+				break;
+			}
+			++word;
+			++skip;
+		}
+		if (word == STATE_WORDS)
+		{
+			// Trailing unchanged words are implied
+			break;
+		}
+
+		uint8_t* header = out;
+		out += RUN_HEADER_BYTES;
+		size_t changed = 0;
+		while (word < STATE_WORDS && changed < MAX_RUN_WORDS)
+		{
+			memcpy(&x, a + word * sizeof(uint64_t), sizeof(x));
+			memcpy(&y, b + word * sizeof(uint64_t), sizeof(y));
+			if (x == y)
+			{
+				break;
+			}
+			x ^= y;
+			memcpy(out, &x, sizeof(x));
+			out += sizeof(x);
+			++word;
+			++changed;
+		}
+
+		uint16_t counts[2] = { static_cast<uint16_t>(skip), static_cast<uint16_t>(changed) };
+		memcpy(header, counts, sizeof(counts));
+	}
+
+	return out - scratch.data();
+}
+
+void RewindBuffer::ApplyDelta(Chip8::State& state, const uint8_t* delta, size_t size)
+{
+	uint8_t* bytes = reinterpret_cast<uint8_t*>(&state);
+	const uint8_t* end = delta + size;
+
+	size_t word = 0;
+	while (delta < end)
+	{
+		uint16_t counts[2];
+		memcpy(counts, delta, sizeof(counts));
+		delta += RUN_HEADER_BYTES;
+
+		word += counts[0];
+		for (uint16_t i = 0; i < counts[1]; ++i, ++word)
+		{
+			uint64_t x;
+			uint64_t y;
+			memcpy(&x, bytes + word * sizeof(uint64_t), sizeof(x));
+			memcpy(&y, delta, sizeof(y));
+			x ^= y;
+			memcpy(bytes + word * sizeof(uint64_t), &x, sizeof(x));
+			delta += sizeof(y);
+		}
+	}
+}
+
+void RewindBuffer::Reserve(size_t size)
+{
+	if (count == 0)
+	{
+		writeOffset = 0;
+		return;
+	}
+
+	// Entries never straddle the end of the arena, the space left there is skipped along with the oldest entries in it
+	if (writeOffset + size > arena.size())
+	{
+		while (count > 0 && GetEntry(0).offset >= writeOffset)
+		{
+			EvictOldestGroup();
+		}
+		writeOffset = 0;
+	}
+
+	// Live entries ahead of the write position are the oldest ones
+	while (count > 0)
+	{
+		const Entry& oldest = GetEntry(0);
+		if (oldest.offset >= writeOffset + size || oldest.offset + oldest.size <= writeOffset)
+		{
+			break;
+		}
+		EvictOldestGroup();
+	}
+	if (count == 0)
+	{
+		writeOffset = 0;
+	}
+}
+
+void RewindBuffer::EvictOldestGroup()
+{
+	// Deltas cannot outlive their keyframe
+	do
+	{
+		usedBytes -= GetEntry(0).size;
+		first = (first + 1) % entries.size();
+		--count;
+	} while (count > 0 && GetEntry(0).keyframeDistance > 0);
+}
\ No newline at end of file
@@ -0,0 +1,128 @@
+#include "SaveStateFiles.h"
+
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+
+SaveStateFiles::SaveStateFiles()
+	: thread(&SaveStateFiles::Run, this)
+{
+}
+
+SaveStateFiles::~SaveStateFiles()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+	wakeUp.notify_one();
+	thread.join();
+}
+
+void SaveStateFiles::Write(const std::string& path, std::vector<uint8_t> data)
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		requests.push_back({ true, path, std::move(data) });
+	}
+	wakeUp.notify_one();
+}
+
+void SaveStateFiles::Read(const std::string& path)
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		requests.push_back({ false, path, {} });
+	}
+	wakeUp.notify_one();
+}
+
+bool SaveStateFiles::PollRead(ReadResult& result)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	if (results.empty())
+	{
+		return false;
+	}
+
+	result = std::move(results.front());
+	results.pop_front();
+	return true;
+}
+
+void SaveStateFiles::Run()
+{
+	std::unique_lock<std::mutex> lock(mutex);
+	while (true)
+	{
+		wakeUp.wait(lock, [this]() { return stopping || !requests.empty(); });
+		if (requests.empty())
+		{
+			// Stopping with nothing left to write
+			return;
+		}
+
+		Request request = std::move(requests.front());
+		requests.pop_front();
+
+		// File access happens unlocked, queuing never waits on the disk
+		lock.unlock();
+		ReadResult result;
+		bool completed = request.write ? WriteFile(request.path, request.data) : ReadFile(request.path, result.data);
+		lock.lock();
+
+		if (!request.write && completed)
+		{
+			result.path = std::move(request.path);
+			results.push_back(std::move(result));
+		}
+	}
+}
+
+bool SaveStateFiles::WriteFile(const std::string& path, const std::vector<uint8_t>& data)
+{
+	std::error_code error;
+	std::filesystem::path target(path);
+	if (target.has_parent_path())
+	{
+		std::filesystem::create_directories(target.parent_path(), error);
+	}
+
+	std::string temporaryPath = path + ".tmp";
+	{
+		std::ofstream file(temporaryPath, std::ios::binary | std::ios::trunc);
+		if (!file || !file.write(reinterpret_cast<const char*>(data.data()), data.size()))
+		{
+			std::cerr << "Failed to write savestate: " << path << std::endl;
+			return false;
+		}
+	}
+
+	std::filesystem::rename(temporaryPath, target, error);
+	if (error)
+	{
+		std::cerr << "Failed to write savestate: " << path << " (" << error.message() << ")" << std::endl;
+		return false;
+	}
+	return true;
+}
+
+bool SaveStateFiles::ReadFile(const std::string& path, std::vector<uint8_t>& data)
+{
+	std::ifstream file(path, std::ios::binary | std::ios::ate);
+	if (!file)
+	{
+		std::cerr << "No savestate: " << path << std::endl;
+		return false;
+	}
+
+	std::streamsize size = file.tellg();
+	file.seekg(0, std::ios::beg);
+	data.resize(static_cast<size_t>(size));
+	if (!file.read(reinterpret_cast<char*>(data.data()), size))
+	{
+		std::cerr << "Failed to read savestate: " << path << std::endl;
+		return false;
+	}
+	return true;
+}
\ No newline at end of file
@@ -1,5 +1,7 @@
 #include "Window.h"
 
+#include <algorithm>
+#include <cstdio>
 #include <filesystem>
 #include <iostream>
 #include <vector>
@@ -13,8 +15,41 @@
 
 const std::string Window::INVALID_ROM = "Invalid ROM";
 
+const Window::Palette Window::PALETTES[PALETTE_COUNT] =
+{
+    { "Classic", { { 0.0f, 0.0f, 0.0f, 1.0f }, { 1.0f, 1.0f, 1.0f, 1.0f } } },
+    { "Amber", { { 0.1f, 0.05f, 0.0f, 1.0f }, { 1.0f, 0.7f, 0.0f, 1.0f } } },
+    { "Phosphor", { { 0.0f, 0.08f, 0.0f, 1.0f }, { 0.2f, 1.0f, 0.3f, 1.0f } } },
+    { "Purple", { { 0.1f, 0.05f, 0.15f, 1.0f }, { 0.8f, 0.6f, 1.0f, 1.0f } } }
+};
+
+// Fullscreen triangle, the vertices are generated from their index
+static const char* DISPLAY_VERTEX_SHADER = R"(
+#version 460 core
+void main()
+{
+    vec2 position = vec2((gl_VertexID << 1) & 2, gl_VertexID & 2);
+    gl_Position = vec4(position * 2.0 - 1.0, 0.0, 1.0);
+}
+)";
+
+// Each display row is one texel, on little-endian hosts the high word (g) holds the left half of the screen, bit 31 first
+static const char* DISPLAY_FRAGMENT_SHADER = R"(
+#version 460 core
+uniform usampler2D display;
+uniform vec4 palette[2];
+out vec4 color;
+void main()
+{
+    ivec2 pixel = ivec2(gl_FragCoord.xy);
+    uvec2 row = texelFetch(display, ivec2(0, pixel.y), 0).rg;
+    uint word = pixel.x < 32 ? row.g : row.r;
+    color = palette[(word >> (31 - (pixel.x & 31))) & 1u];
+}
+)";
+
 Window::Window(const std::string& title, int width, int height, int textureWidth, int textureHeight)
-    : window(nullptr), glContext(nullptr), texture(0)
+    : window(nullptr), glContext(nullptr), texture(0), displayTexture(0), framebuffer(0), displayProgram(0), vertexArray(0)
 {
     this->textureWidth = textureWidth;
     this->textureHeight = textureHeight;
@@ -65,6 +100,8 @@ Window::Window(const std::string& title, int width, int height, int textureWidth
     glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, textureWidth, textureHeight, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
     glBindTexture(GL_TEXTURE_2D, 0);
 
+    InitDisplay();
+
     // TODO: Maybe move this to a separate method
     // Check if the ROMs folder exists and is a directory
     if (!std::filesystem::exists(ROMSFolder) || !std::filesystem::is_directory(ROMSFolder))
@@ -92,6 +129,93 @@ Window::Window(const std::string& title, int width, int height, int textureWidth
     InitAudio();
 }
 
+void Window::InitDisplay()
+{
+    // Packed display, one RG32UI texel per 64-bit row
+    glGenTextures(1, &displayTexture);
+    glBindTexture(GL_TEXTURE_2D, displayTexture);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RG32UI, 1, textureHeight, 0, GL_RG_INTEGER, GL_UNSIGNED_INT, nullptr);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    // The render texture is filled by the expansion shader
+    glGenFramebuffers(1, &framebuffer);
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, texture, 0);
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+    {
+        std::cerr << "Display framebuffer is incomplete" << std::endl;
+        exit(1);
+    }
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+    GLuint vertexShader = CompileShader(GL_VERTEX_SHADER, DISPLAY_VERTEX_SHADER);
+    GLuint fragmentShader = CompileShader(GL_FRAGMENT_SHADER, DISPLAY_FRAGMENT_SHADER);
+
+    displayProgram = glCreateProgram();
+    glAttachShader(displayProgram, vertexShader);
+    glAttachShader(displayProgram, fragmentShader);
+    glLinkProgram(displayProgram);
+    glDeleteShader(vertexShader);
+    glDeleteShader(fragmentShader);
+
+    GLint linked = GL_FALSE;
+    glGetProgramiv(displayProgram, GL_LINK_STATUS, &linked);
+    if (!linked)
+    {
+        char log[512];
+        glGetProgramInfoLog(displayProgram, sizeof(log), nullptr, log);
+        std::cerr << "Failed to link display shader: " << log << std::endl;
+        exit(1);
+    }
+    paletteLocation = glGetUniformLocation(displayProgram, "palette");
+
+    // Core profile draws need a vertex array, even without attributes
+    glGenVertexArrays(1, &vertexArray);
+}
+
+GLuint Window::CompileShader(GLenum type, const char* source)
+{
+    GLuint shader = glCreateShader(type);
+    glShaderSource(shader, 1, &source, nullptr);
+    glCompileShader(shader);
+
+    GLint compiled = GL_FALSE;
+    glGetShaderiv(shader, GL_COMPILE_STATUS, &compiled);
+    if (!compiled)
+    {
+        char log[512];
+        glGetShaderInfoLog(shader, sizeof(log), nullptr, log);
+        std::cerr << "Failed to compile display shader: " << log << std::endl;
+        exit(1);
+    }
+
+    return shader;
+}
+
+void Window::RenderDisplay(const uint64_t* display)
+{
+    // Upload the packed rows, the shader expands them to palette colours
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, displayTexture);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, 1, textureHeight, GL_RG_INTEGER, GL_UNSIGNED_INT, display);
+
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+    glViewport(0, 0, textureWidth, textureHeight);
+
+    const Palette& palette = PALETTES[config.palette % PALETTE_COUNT];
+    glUseProgram(displayProgram);
+    glUniform4fv(paletteLocation, 2, &palette.colors[0][0]);
+    glBindVertexArray(vertexArray);
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+
+    glBindVertexArray(0);
+    glUseProgram(0);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
 void Window::InitAudio()
 {
     audioGen = std::mt19937(std::random_device{}());
@@ -118,6 +242,13 @@ Window::~Window()
     ImGui_ImplSDL3_Shutdown();
     ImGui::DestroyContext();
 
+    // Cleanup display resources
+    glDeleteVertexArrays(1, &vertexArray);
+    glDeleteProgram(displayProgram);
+    glDeleteFramebuffers(1, &framebuffer);
+    glDeleteTextures(1, &displayTexture);
+    glDeleteTextures(1, &texture);
+
     // Cleanup SDL/OpenGL
     SDL_DestroyAudioStream(audioStream);
     SDL_GL_DestroyContext(glContext);
@@ -126,16 +257,15 @@ Window::~Window()
 }
 
 // TODO: Split interfaces in different methods
-void Window::Update(const void* buffer)
+void Window::Update(const uint64_t* display)
 {
+    // Update texture with new pixel data
+    RenderDisplay(display);
+
     glViewport(0, 0, 1920, 1080);
     glClearColor(0.1f, 0.1f, 0.1f, 1.0f);
     glClear(GL_COLOR_BUFFER_BIT);
 
-    // Update texture with new pixel data
-    glBindTexture(GL_TEXTURE_2D, texture);
-    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, textureWidth, textureHeight, GL_RGBA, GL_UNSIGNED_BYTE, buffer);
-
     // Start ImGui frame
     ImGui_ImplOpenGL3_NewFrame();
     ImGui_ImplSDL3_NewFrame();
@@ -185,6 +315,10 @@ void Window::DisplayEditor()
     {
         ImGui::Begin("Info", nullptr, ImGuiWindowFlags_NoResize);
         ImGui::Text("Press ESC to exit");
+        ImGui::Text("F5 / F9: quick save / load slot %u, F1 to F4: select slot", saveStateSlot + 1);
+        ImGui::Text("Hold Backspace to rewind");
+        ImGui::Text("F7: %s, F8: %s", recordingMovie ? "stop recording the movie" : "record a movie",
+            replayingMovie ? "stop replaying" : "replay the movie");
         ImGui::End();
     }
 
@@ -193,6 +327,34 @@ void Window::DisplayEditor()
         ImGui::Begin("Debug Menu", nullptr, ImGuiWindowFlags_NoResize);
 
         ImGui_Utils::DrawIntControl("Cycles", config.emulationCycles, 5, 125);
+        ImGui_Utils::DrawBoolControl("Fusion", config.superinstructions, 125);
+        ImGui_Utils::DrawBoolControl("JIT", config.jit, 125);
+        ImGui_Utils::DrawBoolControl("Rewind", config.rewind, 125);
+        if (config.rewind)
+        {
+            // History is recorded at 60 frames per second of emulated time
+            float seconds = rewindFrames / 60.0f;
+            ImGui::Text("Rewind: %.1f s held in %.1f KB, %.1f KB/s", seconds, rewindBytes / 1024.0f,
+                seconds > 0.0f ? rewindBytes / 1024.0f / seconds : 0.0f);
+            ImGui::Text("Rewind: record %.2f us/frame, step back %.2f us/frame", rewindPushNS / 1000.0f, rewindStepNS / 1000.0f);
+        }
+        ImGui_Utils::DrawIntControl("Run-ahead", config.runAheadFrames, 0, 125);
+        if (config.runAheadFrames > 0)
+        {
+            ImGui::Text("Run-ahead: %llu instructions/s, %.2f ms/s", static_cast<unsigned long long>(runAheadCyclesPerSecond),
+                runAheadNSPerSecond / 1'000'000.0);
+        }
+        ImGui_Utils::DrawComboBoxControl("Quirks", config.quirkProfile, { "COSMAC VIP", "SUPER-CHIP", "XO-CHIP" }, 125);
+
+        std::vector<const char*> cPalettes;
+        for (const Palette& palette : PALETTES)
+        {
+            cPalettes.push_back(palette.name);
+        }
+        ImGui_Utils::DrawComboBoxControl("Palette", config.palette, cPalettes, 125);
+        ImGui_Utils::DrawBoolControl("Input latency", config.showInputLatency, 125);
+        ImGui_Utils::DrawBoolControl("Profiler", config.profiler, 125);
+        ImGui_Utils::DrawBoolControl("Call graph", config.callGraph, 125);
 
         std::vector<const char*> cROMS;
         cROMS.reserve(ROMS.size());
@@ -207,7 +369,10 @@ void Window::DisplayEditor()
 			currentROMIndex = -1; 
         }
 
+		DisplayInputLatency();
 		DisplayRegisters();
+		DisplayProfiler();
+		DisplayCallGraph();
 
         ImGui::End();
     }
@@ -215,7 +380,7 @@ void Window::DisplayEditor()
 
 void Window::DisplayRegisters()
 {
-	if (registersToDisplay)
+	if (hasRegistersToDisplay)
 	{
 		ImGui::NewLine();
 		ImGui::NewLine();
@@ -241,7 +406,166 @@ void Window::DisplayRegisters()
 	}
 }
 
-bool Window::ProcessInput(uint8_t* keys)
+void Window::DisplayProfiler()
+{
+    if (!config.profiler || !hasProfileToDisplay)
+    {
+        return;
+    }
+
+    const Chip8Profiler::Summary& profile = profileToDisplay;
+    float total = profile.instructions > 0 ? static_cast<float>(profile.instructions) : 1.0f;
+
+    ImGui::NewLine();
+    ImGui::Separator();
+    ImGui::Text("Profile: %llu instructions", static_cast<unsigned long long>(profile.instructions));
+    if (ImGui::Button("Reset"))
+    {
+        profileResetRequested = true;
+    }
+    ImGui::SameLine();
+    if (ImGui::Button("Export CSV"))
+    {
+        profileExportRequested = true;
+    }
+
+    // Busiest opcode classes first
+    unsigned int classes[Chip8Profiler::OPCODE_CLASS_COUNT];
+    for (unsigned int i = 0; i < Chip8Profiler::OPCODE_CLASS_COUNT; ++i)
+    {
+        classes[i] = i;
+    }
+    std::stable_sort(std::begin(classes), std::end(classes),
+        [&profile](unsigned int a, unsigned int b) { return profile.opcodeExecutions[a] > profile.opcodeExecutions[b]; });
+
+    ImGui::Separator();
+    ImGui::Columns(2);
+    ImGui::SetColumnWidth(0, 125.0f);
+    ImGui::Text("Opcode");
+    ImGui::NextColumn();
+    ImGui::Text("Instructions");
+    ImGui::Separator();
+    ImGui::NextColumn();
+    for (unsigned int opcodeClass : classes)
+    {
+        uint64_t executions = profile.opcodeExecutions[opcodeClass];
+        if (executions == 0)
+        {
+            break;
+        }
+        ImGui::Text("%s", Chip8Profiler::GetOpcodeClassName(opcodeClass));
+        ImGui::NextColumn();
+        ImGui::ProgressBar(executions / total, ImVec2(-FLT_MIN, 0.0f),
+            std::to_string(executions).c_str());
+        ImGui::NextColumn();
+    }
+    ImGui::Columns(1);
+
+    // Host time per sprite drawn
+    uint64_t draws = profile.opcodeExecutions[Chip8Profiler::GetOpcodeClass(0xD000)];
+    ImGui::Text("Dxyn: %.2f ms, %.0f ns/sprite", profile.drawNS / 1'000'000.0, draws > 0 ? static_cast<double>(profile.drawNS) / draws : 0.0);
+
+    ImGui::Separator();
+    ImGui::Text("Hotspots");
+    for (unsigned int i = 0; i < profile.hotspotCount; ++i)
+    {
+        const Chip8Profiler::Hotspot& hotspot = profile.hotspots[i];
+        ImGui::Text("0x%03X  %04X  %5.1f%%", hotspot.address, hotspot.opcode, hotspot.executions * 100.0f / total);
+    }
+
+    ImGui::Separator();
+    ImGui::Text("Loops");
+    for (unsigned int i = 0; i < profile.loopCount; ++i)
+    {
+        const Chip8Profiler::Loop& loop = profile.loops[i];
+        ImGui::Text("0x%03X-0x%03X  %5.1f%%  %llu iterations", loop.start, loop.end, loop.instructions * 100.0f / total,
+            static_cast<unsigned long long>(loop.iterations));
+    }
+}
+
+void Window::DisplayCallGraph()
+{
+    if (!config.callGraph || !hasCallGraphToDisplay)
+    {
+        return;
+    }
+
+    const Chip8CallGraph::Summary& callGraph = callGraphToDisplay;
+    float total = callGraph.cycles > 0 ? static_cast<float>(callGraph.cycles) : 1.0f;
+
+    ImGui::NewLine();
+    ImGui::Separator();
+    ImGui::Text("Call graph: depth %u, %zu call chains", callGraph.depth, callGraph.nodeCount);
+    if (ImGui::Button("Reset##CallGraph"))
+    {
+        profileResetRequested = true;
+    }
+    ImGui::SameLine();
+    if (ImGui::Button("Export folded stacks"))
+    {
+        profileExportRequested = true;
+    }
+
+    // Instructions run in the subroutine itself, the label adds those of its callees
+    ImGui::Separator();
+    ImGui::Columns(2);
+    ImGui::SetColumnWidth(0, 125.0f);
+    ImGui::Text("Subroutine");
+    ImGui::NextColumn();
+    ImGui::Text("Instructions in it, with callees");
+    ImGui::Separator();
+    ImGui::NextColumn();
+    for (unsigned int i = 0; i < callGraph.subroutineCount; ++i)
+    {
+        const Chip8CallGraph::Subroutine& subroutine = callGraph.subroutines[i];
+        ImGui::Text("0x%03X  %llux", subroutine.address, static_cast<unsigned long long>(subroutine.calls));
+        ImGui::NextColumn();
+        char label[32];
+        snprintf(label, sizeof(label), "%.1f%%, %.1f%%", subroutine.selfCycles * 100.0f / total, subroutine.totalCycles * 100.0f / total);
+        ImGui::ProgressBar(subroutine.selfCycles / total, ImVec2(-FLT_MIN, 0.0f), label);
+        ImGui::NextColumn();
+    }
+    ImGui::Columns(1);
+}
+
+void Window::SetInputLatencyToDisplay(const uint32_t* histogram, int bucketCount, float bucketMS)
+{
+    inputLatencyToDisplay.assign(histogram, histogram + bucketCount);
+    inputLatencyBucketMS = bucketMS;
+}
+
+void Window::DisplayInputLatency()
+{
+    if (!config.showInputLatency || inputLatencyToDisplay.empty())
+    {
+        return;
+    }
+
+    // Median of the key events counted so far
+    float total = 0.0f;
+    for (float count : inputLatencyToDisplay)
+    {
+        total += count;
+    }
+    int median = 0;
+    for (float below = 0.0f; median < static_cast<int>(inputLatencyToDisplay.size()) - 1; ++median)
+    {
+        below += inputLatencyToDisplay[median];
+        if (below * 2.0f >= total)
+        {
+            break;
+        }
+    }
+
+    ImGui::NewLine();
+    ImGui::Separator();
+    ImGui::Text("Input latency, %d ms buckets", static_cast<int>(inputLatencyBucketMS));
+    ImGui::Text("%.0f keys, median %.0f ms", total, median * inputLatencyBucketMS);
+    ImGui::PlotHistogram("##InputLatency", inputLatencyToDisplay.data(), static_cast<int>(inputLatencyToDisplay.size()), 0,
+        nullptr, 0.0f, FLT_MAX, ImVec2(0.0f, 80.0f));
+}
+
+bool Window::ProcessInput(std::vector<KeyEvent>& keyEvents, std::vector<SaveStateEvent>& saveStateEvents, std::vector<MovieEvent>& movieEvents)
 {
     bool running = true;
 
@@ -260,10 +584,32 @@ bool Window::ProcessInput(uint8_t* keys)
                 running = false;
             }
 
+            // Savestates and movies
+            if (event.type == SDL_EVENT_KEY_DOWN && !event.key.repeat)
+            {
+                if (event.key.key >= SDLK_F1 && event.key.key < SDLK_F1 + SAVE_STATE_SLOTS)
+                {
+                    saveStateSlot = event.key.key - SDLK_F1;
+                }
+                else if (event.key.key == SDLK_F5 || event.key.key == SDLK_F9)
+                {
+                    saveStateEvents.push_back({ saveStateSlot, event.key.key == SDLK_F5 });
+                }
+                else if (event.key.key == SDLK_F7 || event.key.key == SDLK_F8)
+                {
+                    movieEvents.push_back(event.key.key == SDLK_F7 ? MovieEvent::ToggleRecording : MovieEvent::ToggleReplay);
+                }
+            }
+
+            if (event.key.key == SDLK_BACKSPACE)
+            {
+                rewindHeld = event.type == SDL_EVENT_KEY_DOWN;
+            }
+
             auto it = keymap.find(event.key.key);
-            if (it != keymap.end())
+            if (it != keymap.end() && !event.key.repeat)
             {
-                keys[it->second] = (event.type == SDL_EVENT_KEY_DOWN) ? 1 : 0;
+                keyEvents.push_back({ it->second, event.type == SDL_EVENT_KEY_DOWN, event.key.timestamp });
             }
         }
 
@@ -274,6 +620,12 @@ bool Window::ProcessInput(uint8_t* keys)
     return running;
 }
 
+bool Window::IsInBackground() const
+{
+    SDL_WindowFlags flags = SDL_GetWindowFlags(window);
+    return (flags & (SDL_WINDOW_MINIMIZED | SDL_WINDOW_HIDDEN | SDL_WINDOW_OCCLUDED)) != 0 || (flags & SDL_WINDOW_INPUT_FOCUS) == 0;
+}
+
 void Window::PlaySound()
 {
     std::vector<float> beepSamples(SAMPLE_COUNT);
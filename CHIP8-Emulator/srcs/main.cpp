@@ -1,59 +1,145 @@
-#include <chrono>
+#include <algorithm>
 
-#include "Chip8.h"
+#include "EmulationThread.h"
+#include "FramePacer.h"
 #include "Window.h"
 
+// Frames per second while the window is in the background, emulation slows down with it
+static constexpr unsigned int BACKGROUND_FRAME_RATE = 10;
+
 int main()
 {
 	std::unique_ptr<Window> window = std::make_unique<Window>("CHIP8-Emulator", 1280, 720, 64, 32);
 
-	std::unique_ptr<Chip8> chip8 = std::make_unique<Chip8>();
-	if (!chip8->LoadROM(window->GetFirstFoundROM()))
+	// The Chip8 lives on the emulation thread, this thread only handles input and rendering
+	std::unique_ptr<EmulationThread> emulation = std::make_unique<EmulationThread>();
+	QuirkProfile quirkProfile = static_cast<QuirkProfile>(window->config.quirkProfile);
+	if (!emulation->Start(window->GetFirstFoundROM(), quirkProfile))
 	{
 		return -1;
 	}
 
-	std::chrono::steady_clock::time_point lastCycleTime = std::chrono::high_resolution_clock::now();
+	// Settings last sent to the emulation thread
+	EmulatorConfig sentConfig = window->config;
+	emulation->Send(EmulationThread::Command::Configure(sentConfig.emulationCycles, sentConfig.superinstructions, sentConfig.jit,
+		sentConfig.runAheadFrames, sentConfig.rewind));
+
+	// Rendering is paced separately, vsync alone does not block while the window is minimised
+	FramePacer pacer(Chip8::TIMER_FREQUENCY);
+	std::vector<KeyEvent> keyEvents;
+	std::vector<SaveStateEvent> saveStateEvents;
+	std::vector<MovieEvent> movieEvents;
+	uint64_t soundFrames = 0;
+	bool rewinding = false;
 
 	bool running = true;
 	while (running)
 	{
-		if (window->HasChangedROM())
+		unsigned int frameRate = window->IsInBackground() ? BACKGROUND_FRAME_RATE : Chip8::TIMER_FREQUENCY;
+		pacer.SetRate(frameRate);
+		emulation->SetFrameRate(frameRate);
+		pacer.WaitForNextFrame();
+
+		// Quirks are selected at load time, switching profile restarts the ROM
+		quirkProfile = static_cast<QuirkProfile>(window->config.quirkProfile);
+		if (window->HasChangedROM() || sentConfig.quirkProfile != window->config.quirkProfile)
 		{
 			window->UpdateCurrentROMIndex();
-			if (!chip8->LoadROM(window->GetCurrentROMToLoad()))
-			{
-				return -1;
-			}
+			emulation->Send(EmulationThread::Command::LoadROM(window->GetCurrentROMToLoad(), quirkProfile));
+			sentConfig.quirkProfile = window->config.quirkProfile;
 		}
 
-		running = window->ProcessInput(chip8->GetKeypad());
+		if (window->config.jit && !emulation->IsJITAvailable())
+		{
+			// Not supported on this host, keep interpreting
+			window->config.jit = false;
+		}
 
-		std::chrono::steady_clock::time_point currentTime = std::chrono::high_resolution_clock::now();
-		float deltaTime = std::chrono::duration<float, std::chrono::milliseconds::period>(currentTime - lastCycleTime).count();
-		bool playSound = false;
+		if ((window->config.profiler || window->config.callGraph) && !emulation->IsProfilerAvailable())
+		{
+			// Core built without CHIP8_PROFILER
+			window->config.profiler = false;
+			window->config.callGraph = false;
+		}
+		if (sentConfig.profiler != window->config.profiler)
+		{
+			sentConfig.profiler = window->config.profiler;
+			emulation->Send(EmulationThread::Command::Profile(sentConfig.profiler));
+		}
+		if (sentConfig.callGraph != window->config.callGraph)
+		{
+			sentConfig.callGraph = window->config.callGraph;
+			emulation->Send(EmulationThread::Command::CallGraph(sentConfig.callGraph));
+		}
+		bool resetProfile = false;
+		bool exportProfile = false;
+		window->TakeProfilerRequests(resetProfile, exportProfile);
+		if (resetProfile)
+		{
+			emulation->Send(EmulationThread::Command::ResetProfile());
+		}
+		if (exportProfile)
+		{
+			emulation->Send(EmulationThread::Command::ExportProfile());
+		}
 
-		// Limit the cycle time to approximately 60Hz (16.67ms per cycle)
-		if (deltaTime > 16.67f)
+		window->config.runAheadFrames = std::clamp(window->config.runAheadFrames, 0, static_cast<int>(EmulationThread::MAX_RUN_AHEAD_FRAMES));
+
+		if (sentConfig.emulationCycles != window->config.emulationCycles || sentConfig.superinstructions != window->config.superinstructions
+			|| sentConfig.jit != window->config.jit || sentConfig.runAheadFrames != window->config.runAheadFrames
+			|| sentConfig.rewind != window->config.rewind)
+		{
+			sentConfig = window->config;
+			emulation->Send(EmulationThread::Command::Configure(sentConfig.emulationCycles, sentConfig.superinstructions, sentConfig.jit,
+				sentConfig.runAheadFrames, sentConfig.rewind));
+		}
+
+		keyEvents.clear();
+		saveStateEvents.clear();
+		movieEvents.clear();
+		running = window->ProcessInput(keyEvents, saveStateEvents, movieEvents);
+		for (const KeyEvent& keyEvent : keyEvents)
+		{
+			emulation->Send(EmulationThread::Command::Key(keyEvent.key, keyEvent.pressed, keyEvent.timestampNS));
+		}
+		for (const SaveStateEvent& saveStateEvent : saveStateEvents)
+		{
+			emulation->Send(saveStateEvent.save ? EmulationThread::Command::SaveState(saveStateEvent.slot)
+				: EmulationThread::Command::LoadState(saveStateEvent.slot));
+		}
+		for (MovieEvent movieEvent : movieEvents)
+		{
+			emulation->Send(movieEvent == MovieEvent::ToggleRecording ? EmulationThread::Command::RecordMovie()
+				: EmulationThread::Command::ReplayMovie());
+		}
+		if (rewinding != window->IsRewindHeld())
 		{
-			lastCycleTime = currentTime;
+			rewinding = window->IsRewindHeld();
+			emulation->Send(EmulationThread::Command::Rewind(rewinding));
+		}
 
-			// Execute CHIP-8 cycles
-			for (int i = 0; i < window->config.emulationCycles; ++i)
-			{
-				chip8->Cycle();
-				playSound = playSound ? true : chip8->GetSoundTimer() > 0;
-			}
+		if (emulation->HasFailed())
+		{
+			return -1;
+		}
 
-			// Rendering
-			window->SetRegistersToDisplay(chip8->GetRegisters());
-			window->Update(chip8->GetVideo());
+		// Rendering, from the latest complete frame
+		const EmulationThread::Frame& frame = emulation->ReadFrame();
+		window->SetRegistersToDisplay(frame.registers);
+		window->SetInputLatencyToDisplay(frame.inputLatency, EmulationThread::INPUT_LATENCY_BUCKETS,
+			EmulationThread::INPUT_LATENCY_BUCKET_NS / 1'000'000.0f);
+		window->SetRunAheadCostToDisplay(frame.runAheadCyclesPerSecond, frame.runAheadNSPerSecond);
+		window->SetRewindStatsToDisplay(frame.rewindFrames, frame.rewindBytes, frame.rewindPushNS, frame.rewindStepNS);
+		window->SetMovieStatusToDisplay(frame.recordingMovie, frame.replayingMovie);
+		window->SetProfileToDisplay(frame.profiling ? &frame.profile : nullptr);
+		window->SetCallGraphToDisplay(frame.callGraphing ? &frame.callGraph : nullptr);
+		window->Update(frame.video);
 
-			// Audio
-			if (playSound)
-			{
-				window->PlaySound();
-			}
+		// Audio
+		if (frame.soundFrames != soundFrames)
+		{
+			soundFrames = frame.soundFrames;
+			window->PlaySound();
 		}
 	}
 }
\ No newline at end of file
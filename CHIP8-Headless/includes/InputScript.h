@@ -0,0 +1,28 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Key events replayed at fixed frames, read from a text file holding one "frame key state" triple per line
+// key is a hexadecimal digit, state is 1 for pressed and 0 for released, # starts a comment
+class InputScript
+{
+public:
+	bool Load(const std::string& filename);
+
+	// Apply every event scheduled up to frame to the keypad, frames must be visited in increasing order
+	void Apply(uint64_t frame, uint8_t* keypad);
+
+private:
+	struct Event
+	{
+		uint64_t frame;
+		uint8_t key;
+		uint8_t state;
+	};
+
+	// Sorted by frame, events of the same frame keep their file order
+	std::vector<Event> events;
+	size_t next = 0;
+};
\ No newline at end of file
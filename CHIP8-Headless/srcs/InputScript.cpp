@@ -0,0 +1,54 @@
+#include "InputScript.h"
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+#include "Chip8.h"
+
+bool InputScript::Load(const std::string& filename)
+{
+	std::ifstream file(filename);
+	if (!file)
+	{
+		std::cerr << "Failed to load input script: " << filename << std::endl;
+		return false;
+	}
+
+	events.clear();
+	next = 0;
+
+	std::string line;
+	for (int lineNumber = 1; std::getline(file, line); ++lineNumber)
+	{
+		line = line.substr(0, line.find('#'));
+		if (line.find_first_not_of(" \t\r") == std::string::npos)
+		{
+			continue;
+		}
+
+		std::istringstream fields(line);
+		uint64_t frame;
+		unsigned int key;
+		unsigned int state;
+		if (!(fields >> frame >> std::hex >> key >> std::dec >> state) || key >= Chip8::KEY_COUNT || state > 1)
+		{
+			std::cerr << filename << ":" << lineNumber << ": expected \"frame key state\"" << std::endl;
+			return false;
+		}
+
+		events.push_back({ frame, static_cast<uint8_t>(key), static_cast<uint8_t>(state) });
+	}
+
+	std::stable_sort(events.begin(), events.end(), [](const Event& a, const Event& b) { return a.frame < b.frame; });
+	return true;
+}
+
+void InputScript::Apply(uint64_t frame, uint8_t* keypad)
+{
+	for (; next < events.size() && events[next].frame <= frame; ++next)
+	{
+		keypad[events[next].key] = events[next].state;
+	}
+}
\ No newline at end of file
@@ -0,0 +1,303 @@
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "Chip8.h"
+#include "Chip8CallGraph.h"
+#include "Chip8Movie.h"
+#include "Chip8Profiler.h"
+#include "InputScript.h"
+
+// Write the display as a plain PBM image, lit pixels are 1
+static bool DumpDisplay(const std::string& filename, const uint64_t* video)
+{
+	std::ofstream file(filename);
+	if (!file)
+	{
+		std::cerr << "Failed to open dump file: " << filename << std::endl;
+		return false;
+	}
+
+	file << "P1\n" << Chip8::VIDEO_WIDTH << " " << Chip8::VIDEO_HEIGHT << "\n";
+	for (unsigned int y = 0; y < Chip8::VIDEO_HEIGHT; ++y)
+	{
+		for (unsigned int x = 0; x < Chip8::VIDEO_WIDTH; ++x)
+		{
+			file << ((video[y] >> (63 - x)) & 1) << (x + 1 < Chip8::VIDEO_WIDTH ? " " : "\n");
+		}
+	}
+	return static_cast<bool>(file);
+}
+
+// Runs a ROM for a number of frames without window, GL context or audio device and prints the final display hash
+// Runs are reproducible: the random generator is seeded from --seed, 0 by default
+// A movie recorded by the emulator brings its own seed, profile, cycles and keypad changes, and runs for its length by default
+// --hotspots writes the execution profile as CSV and --folded the instructions per guest call chain as folded stacks,
+// both need the core built with CHIP8_PROFILER
+// Usage: CHIP8-Headless <rom.ch8> [--frames N] [--cycles perFrame] [--input script.txt | --movie run.c8m] [--dump display.pbm]
+//                       [--seed N] [--profile vip|schip|xochip] [--no-fusion] [--jit] [--hotspots profile.csv]
+//                       [--folded stacks.folded]
+int main(int argc, char** argv)
+{
+	uint64_t frames = 600;
+	bool framesGiven = false;
+	unsigned int cyclesPerFrame = Chip8::DEFAULT_TICK_CYCLES;
+	std::string inputPath;
+	std::string moviePath;
+	std::string dumpPath;
+	std::string hotspotsPath;
+	std::string foldedPath;
+	QuirkProfile profile = QuirkProfile::SuperChip;
+	bool fusion = true;
+	bool jit = false;
+	unsigned int seed = 0;
+
+	std::vector<std::string> positional;
+	for (int i = 1; i < argc; ++i)
+	{
+		std::string arg = argv[i];
+		bool hasValue = i + 1 < argc;
+		if (arg == "--frames" && hasValue)
+		{
+			frames = std::stoull(argv[++i]);
+			framesGiven = true;
+		}
+		else if (arg == "--cycles" && hasValue)
+		{
+			cyclesPerFrame = static_cast<unsigned int>(std::stoul(argv[++i]));
+		}
+		else if (arg == "--input" && hasValue)
+		{
+			inputPath = argv[++i];
+		}
+		else if (arg == "--movie" && hasValue)
+		{
+			moviePath = argv[++i];
+		}
+		else if (arg == "--dump" && hasValue)
+		{
+			dumpPath = argv[++i];
+		}
+		else if (arg == "--hotspots" && hasValue)
+		{
+			hotspotsPath = argv[++i];
+		}
+		else if (arg == "--folded" && hasValue)
+		{
+			foldedPath = argv[++i];
+		}
+		else if (arg == "--seed" && hasValue)
+		{
+			seed = static_cast<unsigned int>(std::stoul(argv[++i]));
+		}
+		else if (arg == "--profile" && hasValue)
+		{
+			std::string name = argv[++i];
+			if (!ParseQuirkProfile(name, profile))
+			{
+				std::cerr << "Unknown quirk profile: " << name << std::endl;
+				return -1;
+			}
+		}
+		else if (arg == "--no-fusion")
+		{
+			fusion = false;
+		}
+		else if (arg == "--jit")
+		{
+			jit = true;
+		}
+		else
+		{
+			positional.push_back(arg);
+		}
+	}
+
+	if (positional.size() != 1 || (!inputPath.empty() && !moviePath.empty()))
+	{
+		std::cerr << "Usage: " << argv[0] << " <rom.ch8> [--frames N] [--cycles perFrame] [--input script.txt | --movie run.c8m] [--dump display.pbm]"
+			<< " [--seed N] [--profile vip|schip|xochip] [--no-fusion] [--jit] [--hotspots profile.csv]"
+			<< " [--folded stacks.folded]" << std::endl;
+		return -1;
+	}
+
+	InputScript input;
+	if (!inputPath.empty() && !input.Load(inputPath))
+	{
+		return -1;
+	}
+
+	Chip8Movie movie;
+	bool replaying = !moviePath.empty();
+	if (replaying && !movie.Load(moviePath))
+	{
+		return -1;
+	}
+
+	std::unique_ptr<Chip8> chip8 = std::make_unique<Chip8>();
+	chip8->SetRandomSeed(seed);
+	chip8->SetQuirkProfile(profile);
+	chip8->SetFusionEnabled(fusion);
+	chip8->SetTickCycles(cyclesPerFrame);
+	if (jit && !chip8->SetJITEnabled(true))
+	{
+		std::cerr << "JIT is not available on this host." << std::endl;
+		return -1;
+	}
+	if (!hotspotsPath.empty() && !chip8->SetProfilerEnabled(true))
+	{
+		std::cerr << "Profiler not built in, configure with -DCHIP8_PROFILER=ON." << std::endl;
+		return -1;
+	}
+	if (!foldedPath.empty() && !chip8->SetCallGraphEnabled(true))
+	{
+		std::cerr << "Profiler not built in, configure with -DCHIP8_PROFILER=ON." << std::endl;
+		return -1;
+	}
+	if (!chip8->LoadROM(positional[0]))
+	{
+		return -1;
+	}
+	if (replaying)
+	{
+		if (!movie.StartReplay(*chip8))
+		{
+			return -1;
+		}
+		if (!framesGiven)
+		{
+			frames = (movie.GetLength() + movie.GetTickCycles() - 1) / movie.GetTickCycles();
+		}
+	}
+
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	uint64_t instructions = 0;
+	uint64_t haltedInstructions = 0;
+	bool movieInSync = false;
+	for (uint64_t frame = 0; frame < frames; ++frame)
+	{
+		Chip8::RunResult result;
+		if (replaying)
+		{
+			result = movie.Replay(*chip8, chip8->GetCyclesToTick());
+			if (movie.IsReplayFinished(*chip8))
+			{
+				// The rest of the frame, and any frame after, runs with the last keypad of the movie
+				replaying = false;
+				movieInSync = movie.IsInSync(*chip8);
+				if (chip8->GetCyclesToTick() != chip8->GetTickCycles())
+				{
+					Chip8::RunResult rest = chip8->RunFrame();
+					result.cycles += rest.cycles;
+					result.haltedCycles += rest.haltedCycles;
+				}
+			}
+		}
+		else
+		{
+			input.Apply(frame, chip8->GetKeypad());
+			result = chip8->RunFrame();
+		}
+		instructions += result.cycles;
+		haltedInstructions += result.haltedCycles;
+	}
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	if (!dumpPath.empty() && !DumpDisplay(dumpPath, chip8->GetVideo()))
+	{
+		return -1;
+	}
+
+	const Chip8Profiler* profiler = chip8->GetProfiler();
+	if (profiler)
+	{
+		std::ofstream file(hotspotsPath);
+		profiler->WriteCSV(file);
+		if (!file)
+		{
+			std::cerr << "Failed to write profile: " << hotspotsPath << std::endl;
+			return -1;
+		}
+	}
+
+	const Chip8CallGraph* callGraph = chip8->GetCallGraph();
+	if (callGraph)
+	{
+		// Flame graphs are rooted at the ROM name
+		std::ofstream file(foldedPath);
+		callGraph->WriteFolded(file, std::filesystem::path(positional[0]).stem().string(), chip8->GetCycleCount());
+		if (!file)
+		{
+			std::cerr << "Failed to write folded stacks: " << foldedPath << std::endl;
+			return -1;
+		}
+	}
+
+	std::cout << "Frames: " << frames << std::endl;
+	if (!moviePath.empty())
+	{
+		std::cout << "Movie: " << movie.GetEventCount() << " keypad changes over " << movie.GetLength() << " instructions, ";
+		if (replaying)
+		{
+			std::cout << "not finished" << std::endl;
+		}
+		else
+		{
+			std::cout << (movieInSync ? "in sync with the recording" : "DESYNCED from the recording") << std::endl;
+		}
+	}
+	std::cout << "Instructions: " << instructions << " (" << haltedInstructions << " skipped while halted)" << std::endl;
+	std::cout << "Time: " << std::fixed << std::setprecision(3) << seconds * 1000.0 << " ms" << std::endl;
+	// Hex fields set their own fill and go back to decimal, the lines that follow print counts
+	std::cout << "Display hash: " << std::hex << std::setw(16) << std::setfill('0') << chip8->GetVideoHash()
+		<< std::dec << std::setfill(' ') << std::endl;
+	if (chip8->GetFault() != Chip8::Fault::None)
+	{
+		std::cout << "Fault: " << Chip8::GetFaultName(chip8->GetFault()) << " at 0x" << std::hex << std::setw(3) << std::setfill('0')
+			<< chip8->GetFaultAddress() << std::dec << std::setfill(' ') << std::endl;
+	}
+	if (profiler)
+	{
+		// Where the instructions went, the CSV has the rest
+		Chip8Profiler::Summary summary;
+		profiler->Summarize(summary);
+		double total = summary.instructions > 0 ? static_cast<double>(summary.instructions) : 1.0;
+		std::cout << std::setprecision(1);
+		for (unsigned int i = 0; i < summary.hotspotCount && i < 3; ++i)
+		{
+			const Chip8Profiler::Hotspot& hotspot = summary.hotspots[i];
+			std::cout << "Hotspot: 0x" << std::hex << std::setfill('0') << std::setw(3) << hotspot.address << " " << std::setw(4) << hotspot.opcode
+				<< std::dec << std::setfill(' ') << ", " << hotspot.executions * 100.0 / total << "% of instructions" << std::endl;
+		}
+		for (unsigned int i = 0; i < summary.loopCount && i < 3; ++i)
+		{
+			const Chip8Profiler::Loop& loop = summary.loops[i];
+			std::cout << "Loop: 0x" << std::hex << std::setfill('0') << std::setw(3) << loop.start << "-0x" << std::setw(3) << loop.end
+				<< std::dec << std::setfill(' ') << ", " << loop.iterations << " iterations, " << loop.instructions * 100.0 / total << "% of instructions" << std::endl;
+		}
+		uint64_t draws = summary.opcodeExecutions[Chip8Profiler::GetOpcodeClass(0xD000)];
+		std::cout << "Draws: " << draws << ", " << std::setprecision(3) << summary.drawNS / 1'000'000.0 << " ms" << std::endl;
+	}
+	if (callGraph)
+	{
+		Chip8CallGraph::Summary summary;
+		callGraph->Summarize(summary, chip8->GetCycleCount());
+		double total = summary.cycles > 0 ? static_cast<double>(summary.cycles) : 1.0;
+		std::cout << std::setprecision(1);
+		for (unsigned int i = 0; i < summary.subroutineCount && i < 3; ++i)
+		{
+			const Chip8CallGraph::Subroutine& subroutine = summary.subroutines[i];
+			std::cout << "Subroutine: 0x" << std::hex << std::setfill('0') << std::setw(3) << subroutine.address << std::dec << std::setfill(' ')
+				<< ", " << subroutine.calls
+				<< " calls, " << subroutine.selfCycles * 100.0 / total << "% of instructions in it, "
+				<< subroutine.totalCycles * 100.0 / total << "% with its callees" << std::endl;
+		}
+	}
+
+	return 0;
+}
\ No newline at end of file
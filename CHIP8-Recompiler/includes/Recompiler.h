@@ -0,0 +1,37 @@
+#pragma once
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "Chip8.h"
+
+// Translates a CHIP-8 ROM into a C++ translation unit that registers itself with Chip8Recompiled.
+// Control flow is recovered statically from 1nnn, 2nnn, Bnnn and the skip instructions, starting at the ROM entry.
+class Recompiler
+{
+public:
+	// Generated code follows the quirks of profile, it only runs when the emulator selects the same one
+	bool Load(const std::string& romPath, QuirkProfile profile);
+	bool Write(const std::string& outputPath, const std::string& name) const;
+
+	size_t GetInstructionCount() const;
+
+private:
+	void RecoverControlFlow();
+	void EmitInstruction(std::ostream& out, unsigned int address) const;
+	// Emit a transfer to target, direct when it was recovered, through the interpreter otherwise
+	void EmitJump(std::ostream& out, unsigned int target) const;
+
+	uint16_t FetchOpcode(unsigned int address) const;
+	bool IsCode(unsigned int address) const { return address < Chip8::MEMORY_SIZE && code[address]; }
+
+private:
+	std::vector<uint8_t> rom;
+	QuirkProfile quirkProfile = QuirkProfile::SuperChip;
+	// Memory as it is right after the ROM is loaded
+	uint8_t memory[Chip8::MEMORY_SIZE] = {};
+	// Addresses recovered as instructions
+	std::vector<bool> code = std::vector<bool>(Chip8::MEMORY_SIZE, false);
+};
\ No newline at end of file
@@ -0,0 +1,361 @@
+#include "Recompiler.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <iterator>
+#include <sstream>
+
+#include "Chip8Recompiled.h"
+
+using Operation = Chip8Recompiled::Operation;
+
+namespace
+{
+	std::string Hex(unsigned int value, int width = 3)
+	{
+		std::ostringstream out;
+		out << "0x" << std::uppercase << std::hex << std::setw(width) << std::setfill('0') << value;
+		return out.str();
+	}
+
+	std::string Label(unsigned int address)
+	{
+		std::ostringstream out;
+		out << "L" << std::uppercase << std::hex << std::setw(3) << std::setfill('0') << address;
+		return out.str();
+	}
+
+	// Enumerator names of QuirkProfile, written in the generated registrar
+	const char* PROFILE_NAMES[] = { "CosmacVIP", "SuperChip", "XOChip" };
+
+	bool IsSkip(Operation operation)
+	{
+		return operation == Operation::OP_3xnn || operation == Operation::OP_4xnn || operation == Operation::OP_5xy0
+			|| operation == Operation::OP_9xy0 || operation == Operation::OP_Ex9E || operation == Operation::OP_ExA1;
+	}
+}
+
+bool Recompiler::Load(const std::string& romPath, QuirkProfile profile)
+{
+	quirkProfile = profile;
+
+	std::ifstream file(romPath, std::ios::binary);
+	if (!file)
+	{
+		std::cerr << "Failed to load ROM: " << romPath << std::endl;
+		return false;
+	}
+	rom.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+
+	// Let the core lay out memory so fonts and ROM sit exactly where they will at runtime
+	std::unique_ptr<Chip8> chip8 = std::make_unique<Chip8>();
+	if (!chip8->LoadROM(romPath))
+	{
+		return false;
+	}
+	std::memcpy(memory, Chip8Recompiled::GetState(*chip8).memory, sizeof(memory));
+
+	RecoverControlFlow();
+	return true;
+}
+
+size_t Recompiler::GetInstructionCount() const
+{
+	return std::count(code.begin(), code.end(), true);
+}
+
+uint16_t Recompiler::FetchOpcode(unsigned int address) const
+{
+	return (memory[address] << 8) | memory[address + 1];
+}
+
+void Recompiler::RecoverControlFlow()
+{
+	std::vector<unsigned int> worklist = { Chip8::START_ADDRESS };
+
+	while (!worklist.empty())
+	{
+		unsigned int address = worklist.back();
+		worklist.pop_back();
+
+		// Instructions straddling the end of memory are left to the interpreter
+		if (address + 1 >= Chip8::MEMORY_SIZE || code[address])
+		{
+			continue;
+		}
+		code[address] = true;
+
+		uint16_t opcode = FetchOpcode(address);
+		uint16_t nnn = opcode & 0x0FFF;
+		Operation operation = Chip8Recompiled::GetOperation(opcode);
+
+		switch (operation)
+		{
+		case Operation::OP_00EE:
+			// Return targets are recovered from the matching 2nnn
+			break;
+		case Operation::OP_1nnn:
+			worklist.push_back(nnn);
+			break;
+		case Operation::OP_2nnn:
+			worklist.push_back(nnn);
+			worklist.push_back(address + 2);
+			break;
+		case Operation::OP_Bnnn:
+			// Computed jump: only the base is known statically, other targets go through the interpreter
+			worklist.push_back(nnn);
+			break;
+		default:
+			if (IsSkip(operation))
+			{
+				worklist.push_back(address + 4);
+			}
+			worklist.push_back(address + 2);
+			break;
+		}
+	}
+}
+
+bool Recompiler::Write(const std::string& outputPath, const std::string& name) const
+{
+	std::ofstream out(outputPath);
+	if (!out)
+	{
+		std::cerr << "Failed to open output file: " << outputPath << std::endl;
+		return false;
+	}
+
+	out << "// Generated by CHIP8-Recompiler from " << name << ", do not edit\n";
+	out << "#include \"Chip8.h\"\n";
+	out << "#include \"Chip8Recompiled.h\"\n\n";
+	out << "namespace\n{\n";
+
+	// ROM image used to match the loaded ROM
+	out << "\tconst uint8_t IMAGE[] =\n\t{";
+	for (size_t i = 0; i < rom.size(); ++i)
+	{
+		out << (i % 16 == 0 ? "\n\t\t" : " ") << Hex(rom[i], 2) << ",";
+	}
+	out << "\n\t};\n\n";
+
+	// Bytes read as code, writes to them hand the ROM back to the interpreter
+	uint8_t codeMap[Chip8::MEMORY_SIZE / 8] = {};
+	for (unsigned int address = 0; address < Chip8::MEMORY_SIZE; ++address)
+	{
+		if (code[address])
+		{
+			codeMap[address / 8] |= 1 << (address % 8);
+			codeMap[(address + 1) / 8] |= 1 << ((address + 1) % 8);
+		}
+	}
+	out << "\tconst uint8_t CODE_MAP[] =\n\t{";
+	for (size_t i = 0; i < sizeof(codeMap); ++i)
+	{
+		out << (i % 16 == 0 ? "\n\t\t" : " ") << Hex(codeMap[i], 2) << ",";
+	}
+	out << "\n\t};\n\n";
+
+	out << "\tunsigned int Run(Chip8& chip8, unsigned int budget)\n\t{\n";
+	out << "\t\tChip8Recompiled::State s = Chip8Recompiled::GetState(chip8);\n";
+	out << "\t\tuint8_t* V = s.registers;\n";
+	out << "\t\tunsigned int remaining = budget;\n\n";
+	// Timers are ticked by Chip8::Cycle between calls, a call never runs past a tick
+	out << "\t\tauto retire = [&remaining]() { --remaining; };\n\n";
+
+	std::ostringstream body;
+	for (unsigned int address = 0; address < Chip8::MEMORY_SIZE; ++address)
+	{
+		if (code[address])
+		{
+			EmitInstruction(body, address);
+		}
+	}
+
+	// Entry, returns and computed jumps land here, the label is only emitted when something jumps back to it
+	bool dispatched = body.str().find("goto dispatch;") != std::string::npos;
+	out << (dispatched ? "\tdispatch:\n" : "") << "\t\tswitch (s.pc)\n\t\t{\n";
+	for (unsigned int address = 0; address < Chip8::MEMORY_SIZE; ++address)
+	{
+		if (code[address])
+		{
+			out << "\t\tcase " << Hex(address) << ": goto " << Label(address) << ";\n";
+		}
+	}
+	out << "\t\tdefault: return budget - remaining;\n\t\t}\n";
+	out << body.str();
+
+	out << "\t}\n\n";
+	out << "\tconst Chip8Recompiled::Registrar registrar({ \"" << name << "\", IMAGE, sizeof(IMAGE), CODE_MAP, QuirkProfile::"
+		<< PROFILE_NAMES[static_cast<int>(quirkProfile)] << ", &Run });\n";
+	out << "}\n";
+
+	return static_cast<bool>(out);
+}
+
+void Recompiler::EmitJump(std::ostream& out, unsigned int target) const
+{
+	if (IsCode(target))
+	{
+		out << "goto " << Label(target) << ";";
+	}
+	else
+	{
+		out << "{ s.pc = " << Hex(target) << "; return budget - remaining; }";
+	}
+}
+
+void Recompiler::EmitInstruction(std::ostream& out, unsigned int address) const
+{
+	const uint16_t opcode = FetchOpcode(address);
+	const Operation operation = Chip8Recompiled::GetOperation(opcode);
+	const std::string x = Hex((opcode & 0x0F00) >> 8, 1);
+	const std::string y = Hex((opcode & 0x00F0) >> 4, 1);
+	const std::string nn = Hex(opcode & 0x00FF, 2);
+	const unsigned int nnn = opcode & 0x0FFF;
+	const std::string next = Hex(address + 2);
+	const std::string Vx = "V[" + x + "]";
+	const std::string Vy = "V[" + y + "]";
+	const Chip8Quirks& quirks = GetQuirks(quirkProfile);
+	// Register shifted by 8xy6 and 8xyE
+	const std::string shifted = quirks.shiftUsesVy ? Vy : Vx;
+	const std::string resetVF = quirks.logicResetsVF ? "\t\tV[0xF] = 0;\n" : "";
+
+	out << "\n\t" << Label(address) << ": // " << Hex(opcode, 4) << "\n";
+	out << "\t\tif (remaining == 0) { s.pc = " << Hex(address) << "; return budget - remaining; }\n";
+
+	// Instructions running through the interpreter handlers, PC points past them like in Cycle()
+	auto emitExecute = [&]()
+	{
+		out << "\t\ts.pc = " << next << ";\n";
+		out << "\t\tChip8Recompiled::Execute(chip8, " << Hex(opcode, 4) << ");\n";
+		out << "\t\tretire();\n";
+	};
+
+	bool fallsThrough = true;
+	switch (operation)
+	{
+	case Operation::OP_NULL:
+	case Operation::OP_00E0:
+	case Operation::OP_Cxnn:
+	case Operation::OP_Dxyn:
+		emitExecute();
+		break;
+	case Operation::OP_Fx33:
+	case Operation::OP_Fx55:
+		emitExecute();
+		out << "\t\tif (!Chip8Recompiled::IsActive(chip8)) return budget - remaining;\n";
+		break;
+	case Operation::OP_Fx0A:
+		// Return while no key is held, the interpreter fast-forwards the wait
+		emitExecute();
+		out << "\t\tif (s.pc != " << next << ") return budget - remaining;\n";
+		break;
+	case Operation::OP_00EE:
+		out << "\t\tif (s.sp == 0 || s.sp > " << Chip8::STACK_LEVELS << ") { s.pc = " << Hex(address) << "; return budget - remaining; }\n";
+		out << "\t\t--s.sp;\n\t\ts.pc = s.stack[s.sp];\n\t\tretire();\n\t\tgoto dispatch;\n";
+		fallsThrough = false;
+		break;
+	case Operation::OP_1nnn:
+		if (nnn == address)
+		{
+			// Jump to self, left to the interpreter which fast-forwards it
+			out << "\t\ts.pc = " << Hex(address) << ";\n\t\treturn budget - remaining;\n";
+			fallsThrough = false;
+			break;
+		}
+		out << "\t\tretire();\n\t\t";
+		EmitJump(out, nnn);
+		out << "\n";
+		fallsThrough = false;
+		break;
+	case Operation::OP_2nnn:
+		out << "\t\tif (s.sp >= " << Chip8::STACK_LEVELS << ") { s.pc = " << Hex(address) << "; return budget - remaining; }\n";
+		out << "\t\ts.stack[s.sp++] = " << next << ";\n\t\tretire();\n\t\t";
+		EmitJump(out, nnn);
+		out << "\n";
+		fallsThrough = false;
+		break;
+	case Operation::OP_Bnnn:
+		out << "\t\ts.pc = " << Hex(nnn) << " + " << (quirks.jumpUsesVx ? Vx : "V[0]") << ";\n\t\tretire();\n\t\tgoto dispatch;\n";
+		fallsThrough = false;
+		break;
+	case Operation::OP_3xnn:
+	case Operation::OP_4xnn:
+	case Operation::OP_5xy0:
+	case Operation::OP_9xy0:
+	case Operation::OP_Ex9E:
+	case Operation::OP_ExA1:
+	{
+		std::string condition;
+		switch (operation)
+		{
+		case Operation::OP_3xnn: condition = Vx + " == " + nn; break;
+		case Operation::OP_4xnn: condition = Vx + " != " + nn; break;
+		case Operation::OP_5xy0: condition = Vx + " == " + Vy; break;
+		case Operation::OP_9xy0: condition = Vx + " != " + Vy; break;
+		case Operation::OP_Ex9E: condition = "s.keypad[" + Vx + " & 0xF] != 0"; break;
+		default: condition = "s.keypad[" + Vx + " & 0xF] == 0"; break;
+		}
+		out << "\t\t{\n\t\t\tbool skip = " << condition << ";\n\t\t\tretire();\n\t\t\tif (skip) ";
+		EmitJump(out, address + 4);
+		out << "\n\t\t}\n";
+		break;
+	}
+	case Operation::OP_6xnn: out << "\t\t" << Vx << " = " << nn << ";\n\t\tretire();\n"; break;
+	case Operation::OP_7xnn: out << "\t\t" << Vx << " += " << nn << ";\n\t\tretire();\n"; break;
+	case Operation::OP_8xy0: out << "\t\t" << Vx << " = " << Vy << ";\n\t\tretire();\n"; break;
+	case Operation::OP_8xy1: out << "\t\t" << Vx << " |= " << Vy << ";\n" << resetVF << "\t\tretire();\n"; break;
+	case Operation::OP_8xy2: out << "\t\t" << Vx << " &= " << Vy << ";\n" << resetVF << "\t\tretire();\n"; break;
+	case Operation::OP_8xy3: out << "\t\t" << Vx << " ^= " << Vy << ";\n" << resetVF << "\t\tretire();\n"; break;
+	case Operation::OP_8xy4:
+		out << "\t\t{\n\t\t\tuint16_t sum = " << Vx << " + " << Vy << ";\n";
+		out << "\t\t\t" << Vx << " = sum & 0xFF;\n\t\t\tV[0xF] = sum > 0xFF ? 1 : 0;\n\t\t}\n\t\tretire();\n";
+		break;
+	case Operation::OP_8xy5:
+		out << "\t\tV[0xF] = " << Vx << " > " << Vy << " ? 1 : 0;\n";
+		out << "\t\t" << Vx << " -= " << Vy << ";\n\t\tretire();\n";
+		break;
+	case Operation::OP_8xy6:
+		out << "\t\t{\n\t\t\tuint8_t value = " << shifted << ";\n";
+		out << "\t\t\tV[0xF] = value & 0x01;\n\t\t\t" << Vx << " = value >> 1;\n\t\t}\n\t\tretire();\n";
+		break;
+	case Operation::OP_8xy7:
+		out << "\t\tV[0xF] = " << Vy << " > " << Vx << " ? 1 : 0;\n";
+		out << "\t\t" << Vx << " = " << Vy << " - " << Vx << ";\n\t\tretire();\n";
+		break;
+	case Operation::OP_8xyE:
+		out << "\t\t{\n\t\t\tuint8_t value = " << shifted << ";\n";
+		out << "\t\t\tV[0xF] = (value & 0x80) >> 7;\n\t\t\t" << Vx << " = value << 1;\n\t\t}\n\t\tretire();\n";
+		break;
+	case Operation::OP_Annn: out << "\t\ts.index = " << Hex(nnn) << ";\n\t\tretire();\n"; break;
+	case Operation::OP_Fx07: out << "\t\t" << Vx << " = s.delayTimer;\n\t\tretire();\n"; break;
+	case Operation::OP_Fx15: out << "\t\ts.delayTimer = " << Vx << ";\n\t\tretire();\n"; break;
+	case Operation::OP_Fx18: out << "\t\ts.soundTimer = " << Vx << ";\n\t\tretire();\n"; break;
+	case Operation::OP_Fx1E: out << "\t\ts.index += " << Vx << ";\n\t\tretire();\n"; break;
+	case Operation::OP_Fx29:
+		out << "\t\ts.index = " << Hex(Chip8::FONTSET_START_ADDRESS) << " + " << Vx << " * 5;\n\t\tretire();\n";
+		break;
+	case Operation::OP_Fx65:
+		for (unsigned int i = 0; i <= static_cast<unsigned int>((opcode & 0x0F00) >> 8); ++i)
+		{
+			out << "\t\tV[" << Hex(i, 1) << "] = s.memory[(s.index + " << i << ") & " << Hex(Chip8::MEMORY_SIZE - 1) << "];\n";
+		}
+		if (quirks.loadStoreIncrementsIndex)
+		{
+			out << "\t\ts.index += " << ((opcode & 0x0F00) >> 8) + 1 << ";\n";
+		}
+		out << "\t\tretire();\n";
+		break;
+	}
+
+	// Continue with the next instruction, falling through when it is emitted right after this one
+	if (fallsThrough && (IsCode(address + 1) || !IsCode(address + 2)))
+	{
+		out << "\t\t";
+		EmitJump(out, address + 2);
+		out << "\n";
+	}
+}
\ No newline at end of file
@@ -0,0 +1,51 @@
+#include <filesystem>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "Recompiler.h"
+
+// Translates a ROM to C++, link the output next to the core to run it natively
+// Usage: CHIP8-Recompiler <rom.ch8> <output.cpp> [name] [--profile vip|schip|xochip]
+int main(int argc, char** argv)
+{
+	QuirkProfile profile = QuirkProfile::SuperChip;
+
+	std::vector<std::string> positional;
+	for (int i = 1; i < argc; ++i)
+	{
+		std::string arg = argv[i];
+		if (arg == "--profile" && i + 1 < argc)
+		{
+			std::string name = argv[++i];
+			if (!ParseQuirkProfile(name, profile))
+			{
+				std::cerr << "Unknown quirk profile: " << name << std::endl;
+				return -1;
+			}
+		}
+		else
+		{
+			positional.push_back(arg);
+		}
+	}
+
+	if (positional.size() < 2)
+	{
+		std::cerr << "Usage: " << argv[0] << " <rom.ch8> <output.cpp> [name] [--profile vip|schip|xochip]" << std::endl;
+		return -1;
+	}
+
+	std::string romPath = positional[0];
+	std::string outputPath = positional[1];
+	std::string name = positional.size() > 2 ? positional[2] : std::filesystem::path(romPath).stem().string();
+
+	Recompiler recompiler;
+	if (!recompiler.Load(romPath, profile) || !recompiler.Write(outputPath, name))
+	{
+		return -1;
+	}
+
+	std::cout << name << ": " << recompiler.GetInstructionCount() << " instructions recovered" << std::endl;
+	return 0;
+}
\ No newline at end of file
@@ -0,0 +1,157 @@
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <initializer_list>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "Chip8.h"
+#include "Chip8CallGraph.h"
+
+namespace
+{
+	int failures = 0;
+
+	void Check(bool condition, const std::string& what)
+	{
+		if (!condition)
+		{
+			std::cerr << "FAILED: " << what << std::endl;
+			++failures;
+		}
+	}
+
+	// Place a program at address and start executing it there, registers are left as they are
+	void LoadProgram(Chip8& chip8, unsigned int address, std::initializer_list<uint8_t> bytes)
+	{
+		auto state = std::make_unique<Chip8::State>(chip8.GetState());
+		memcpy(state->memory + address, bytes.begin(), bytes.size());
+		state->pc = static_cast<uint16_t>(address);
+		chip8.SetState(*state);
+	}
+
+	// Write a ROM file in the temporary folder, returns its path
+	std::string WriteROM(const std::string& name, std::initializer_list<uint8_t> bytes)
+	{
+		std::filesystem::path path = std::filesystem::temp_directory_path() / name;
+		std::ofstream file(path, std::ios::binary);
+		file.write(reinterpret_cast<const char*>(bytes.begin()), bytes.size());
+		return path.string();
+	}
+
+	// Fx55 storing over its own opcode must still advance I by its own x, not by the x of what it wrote
+	void TestStoreOverwritingItself(bool fusion, bool jit)
+	{
+		std::string name = std::string("Fx55 overwriting itself") + (fusion ? ", fusion" : "") + (jit ? ", JIT" : "");
+
+		Chip8 chip8;
+		chip8.SetQuirkProfile(QuirkProfile::CosmacVIP);
+		chip8.SetFusionEnabled(fusion);
+		if (jit && !chip8.SetJITEnabled(true))
+		{
+			return;
+		}
+
+		auto state = std::make_unique<Chip8::State>(chip8.GetState());
+		// V2 and V3 land on the FC55 at 0x2EE and turn it into F055
+		state->registers[2] = 0xF0;
+		state->registers[3] = 0x55;
+		chip8.SetState(*state);
+		LoadProgram(chip8, 0x2EE, { 0xFC, 0x55 });
+		LoadProgram(chip8, Chip8::START_ADDRESS, { 0xA2, 0xEC, 0x12, 0xEE });
+
+		chip8.RunCycles(3);
+		Check(chip8.GetState().index == 0x2EC + 0xD, name + ": I is " + std::to_string(chip8.GetState().index));
+		Check(chip8.GetState().memory[0x2EE] == 0xF0 && chip8.GetState().memory[0x2EF] == 0x55, name + ": memory");
+	}
+
+	// A savestate brings back the hash of the ROM it was saved with, not the one loaded before it
+	void TestSaveStateROMHash()
+	{
+		Chip8 saved;
+		Check(saved.LoadROM(WriteROM("chip8_tests_a.ch8", { 0x60, 0x01, 0x12, 0x02 })), "savestate ROM hash: load A");
+		saved.RunCycles(4);
+		std::vector<uint8_t> buffer(Chip8::SAVE_STATE_SIZE);
+		saved.SaveState(buffer.data());
+
+		Chip8 loaded;
+		Check(loaded.LoadROM(WriteROM("chip8_tests_b.ch8", { 0x61, 0x02, 0x12, 0x02, 0x00 })), "savestate ROM hash: load B");
+		Check(loaded.LoadState(buffer.data(), buffer.size()), "savestate ROM hash: load state");
+		Check(loaded.GetROMHash() == saved.GetROMHash(), "savestate ROM hash: hash of A restored");
+	}
+
+	// Depth of the call stack the call graph rebuilds when the machine is restored to where it is
+	unsigned int GetRebuiltCallDepth(Chip8& chip8)
+	{
+		chip8.SetState(*std::make_unique<Chip8::State>(chip8.GetState()));
+		Chip8CallGraph::Summary summary;
+		chip8.GetCallGraph()->Summarize(summary, chip8.GetCycleCount());
+		return summary.depth;
+	}
+
+	// A recursion 17 levels deep overflows the stack, its returns then run past the bottom:
+	// the first fault is the overflow but nothing on the wrapped stack is a call
+	void TestCallGraphOverflowThenUnderflow()
+	{
+		Chip8 chip8;
+		if (!chip8.SetCallGraphEnabled(true))
+		{
+			std::cout << "Call graph tests skipped, the core is built without CHIP8_PROFILER." << std::endl;
+			return;
+		}
+
+		// 0x200: V0 = 17, call 0x208, return, jump to self
+		// 0x208: V0 -= 1, skip the call when V0 is 0, call 0x208, return
+		LoadProgram(chip8, Chip8::START_ADDRESS, { 0x60, 0x11, 0x22, 0x08, 0x00, 0xEE, 0x12, 0x06,
+			0x70, 0xFF, 0x30, 0x00, 0x22, 0x08, 0x00, 0xEE });
+		for (unsigned int i = 0; i < 1000 && chip8.GetState().sp != 0xFF; ++i)
+		{
+			chip8.RunCycles(1);
+		}
+		Check(chip8.GetState().sp == 0xFF && chip8.GetFault() == Chip8::Fault::StackOverflow,
+			"call graph after overflow then underflow: stack wrapped below the bottom");
+		Check(GetRebuiltCallDepth(chip8) == 0, "call graph after overflow then underflow: no call rebuilt");
+	}
+
+	// After an underflow the stack was balanced again, a later overflow is a real chain of calls
+	void TestCallGraphUnderflowThenOverflow()
+	{
+		Chip8 chip8;
+		if (!chip8.SetCallGraphEnabled(true))
+		{
+			return;
+		}
+
+		auto state = std::make_unique<Chip8::State>(chip8.GetState());
+		state->fault = Chip8::Fault::StackUnderflow;
+		chip8.SetState(*state);
+		// 0x200: V0 = 17, call 0x206, jump to self
+		// 0x206: V0 -= 1, skip the call when V0 is 0, call 0x206, jump to self
+		LoadProgram(chip8, Chip8::START_ADDRESS, { 0x60, 0x11, 0x22, 0x06, 0x12, 0x04,
+			0x70, 0xFF, 0x30, 0x00, 0x22, 0x06, 0x12, 0x0C });
+		chip8.RunCycles(200);
+		Check(chip8.GetState().sp == Chip8::STACK_LEVELS + 1, "call graph after underflow then overflow: 17 calls");
+		Check(GetRebuiltCallDepth(chip8) == Chip8::STACK_LEVELS, "call graph after underflow then overflow: stack rebuilt");
+	}
+}
+
+// Regression tests of the core, returns -1 when any of them fails
+int main()
+{
+	TestStoreOverwritingItself(true, false);
+	TestStoreOverwritingItself(false, false);
+	TestStoreOverwritingItself(true, true);
+	TestSaveStateROMHash();
+	TestCallGraphOverflowThenUnderflow();
+	TestCallGraphUnderflowThenOverflow();
+
+	if (failures > 0)
+	{
+		std::cerr << failures << " check(s) failed." << std::endl;
+		return -1;
+	}
+	std::cout << "All checks passed." << std::endl;
+	return 0;
+}
\ No newline at end of file